@@ -374,6 +374,7 @@ Node::op_format() const
 		  break;
 
 		case Runtime::DEFERPROC:
+		case Runtime::DEFERPROCSTACK:
 		  op << "defer";
 		  break;
 
@@ -531,9 +532,11 @@ Node::is_big(Escape_context* context) const
 	      && (fn->runtime_code() == Runtime::MAKESLICE
 		  || fn->runtime_code() == Runtime::MAKESLICE64))
 	    {
-	      // Second argument is length.
+	      // Third argument is capacity, which determines the size
+	      // of the allocation.
 	      Expression_list::iterator p = call->args()->begin();
 	      ++p;
+	      ++p;
 
               Expression* e = *p;
               if (e->temporary_reference_expression() != NULL)
@@ -1436,6 +1439,7 @@ Escape_analysis_assign::statement(Block*, size_t*, Statement* s)
           // runs before the function finishes.
           Node* n = Node::make_node(s);
           n->set_encoding(Node::ESCAPE_NONE);
+          s->defer_statement()->set_on_stack();
           break;
         }
       // fallthrough
@@ -1617,6 +1621,8 @@ Escape_analysis_assign::expression(Expression** pexpr)
                 break;
 
               case Runtime::SELECTSEND:
+              case Runtime::SELECTNBSEND:
+              case Runtime::CHANSEND:
                 {
                   // Send to a channel, lose track. The last argument is
                   // the address of the value to send.
@@ -1766,6 +1772,19 @@ Escape_analysis_assign::expression(Expression** pexpr)
       }
       break;
 
+    case Expression::EXPRESSION_INTERFACE_FIELD_REFERENCE:
+      {
+	// When used as a method value this builds a closure holding
+	// the interface value, like a bound method.
+	Node* field_node = Node::make_node(*pexpr);
+	this->context_->track(field_node);
+
+	Expression* obj =
+	  (*pexpr)->interface_field_reference_expression()->expr();
+	this->assign(this->context_->sink(), Node::make_node(obj));
+      }
+      break;
+
     case Expression::EXPRESSION_MAP_CONSTRUCTION:
       {
 	Map_construction_expression* mce = (*pexpr)->map_literal();
@@ -2265,6 +2284,8 @@ Escape_analysis_assign::assign(Node* dst, Node* src)
 	  // DST = new(T).
 	case Expression::EXPRESSION_BOUND_METHOD:
 	  // DST = x.M.
+	case Expression::EXPRESSION_INTERFACE_FIELD_REFERENCE:
+	  // DST = i.M.
         case Expression::EXPRESSION_STRING_CONCAT:
           // DST = str1 + str2
 	  this->flows(dst, src);
@@ -2399,6 +2420,15 @@ Escape_analysis_assign::assign(Node* dst, Node* src)
                 this->flows(dst, src);
                 break;
               }
+            if (tt->interface_type() != NULL
+                && ft->interface_type() == NULL
+                && ft->points_to() == NULL)
+              {
+                // Converting a non-pointer value to an interface
+                // makes a copy of the value, which flows to DST.
+                this->flows(dst, src);
+                break;
+              }
             // Conversion preserves input value.
             Expression* underlying = tce->expr();
             this->assign(dst, Node::make_node(underlying));
@@ -3121,7 +3151,8 @@ Escape_analysis_flood::flood(Level level, Node* dst, Node* src,
       else if ((e->map_literal() != NULL
                || e->string_concat_expression() != NULL
                || (e->func_expression() != NULL && e->func_expression()->closure() != NULL)
-               || e->bound_method_expression() != NULL)
+               || e->bound_method_expression() != NULL
+               || e->interface_field_reference_expression() != NULL)
                && src_leaks)
         {
           src->set_encoding(Node::ESCAPE_HEAP);
@@ -3146,6 +3177,18 @@ Escape_analysis_flood::flood(Level level, Node* dst, Node* src,
                           src->ast_format(gogo).c_str());
               extra_loop_depth = mod_loop_depth;
             }
+          else if (tt->interface_type() != NULL
+                   && ft->interface_type() == NULL
+                   && ft->points_to() == NULL)
+            {
+              // Converting a non-pointer value to an interface
+              // makes a copy of the value, like an allocation.
+              src->set_encoding(Node::ESCAPE_HEAP);
+              if (debug_level != 0 && osrcesc != src->encoding())
+                go_inform(src->location(), "%s escapes to heap",
+                          src->ast_format(gogo).c_str());
+              extra_loop_depth = mod_loop_depth;
+            }
         }
       else if (e->array_index_expression() != NULL
                && !e->array_index_expression()->array()->type()->is_slice_type())
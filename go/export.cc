@@ -26,21 +26,28 @@ const int Export::magic_len;
 // Current version magic string.
 const char Export::cur_magic[Export::magic_len] =
   {
-    'v', '2', ';', '\n'
+    'v', '3', ';', '\n'
   };
 
-// Magic string for previous version (still supported)
+// Magic strings for previous versions (still supported).  Version 3
+// added the typedescs directive.
 const char Export::v1_magic[Export::magic_len] =
   {
     'v', '1', ';', '\n'
   };
 
+const char Export::v2_magic[Export::magic_len] =
+  {
+    'v', '2', ';', '\n'
+  };
+
 const int Export::checksum_len;
 
 // Constructor.
 
 Export::Export(Stream* stream)
-  : stream_(stream), type_refs_(), type_index_(1), packages_()
+  : stream_(stream), type_refs_(), type_index_(1), packages_(),
+    unnamed_types_(), type_descriptors_()
 {
   go_assert(Export::checksum_len == Go_sha1_helper::checksum_len);
 }
@@ -179,6 +186,8 @@ Export::export_globals(const std::string& package_name,
        ++p)
     (*p)->export_named_object(this);
 
+  this->write_type_descriptors();
+
   std::string checksum = this->stream_->checksum();
   std::string s = "checksum ";
   for (std::string::const_iterator p = checksum.begin();
@@ -625,7 +634,43 @@ Export::write_type(const Type* type)
   this->write_c_string(">");
 
   if (named_type == NULL)
-    this->type_refs_[type] = index;
+    {
+      this->type_refs_[type] = index;
+      if (forward == NULL)
+	this->unnamed_types_.push_back(const_cast<Type*>(type));
+    }
+}
+
+// Write out the unnamed types that appear in the export data and
+// whose type descriptors we will define.  A package that imports this
+// one can refer to those descriptors rather than defining its own.
+
+void
+Export::write_type_descriptors()
+{
+  // Identical unnamed types share a descriptor; only list one.
+  Unordered_set_hash(const Type*, Type_hash_identical, Type_identical) seen;
+  for (std::vector<Type*>::const_iterator p = this->unnamed_types_.begin();
+       p != this->unnamed_types_.end();
+       ++p)
+    {
+      Type* type = *p;
+      if (type->should_export_type_descriptor() && seen.insert(type).second)
+	this->type_descriptors_.push_back(type);
+    }
+
+  if (this->type_descriptors_.empty())
+    return;
+
+  this->write_c_string("typedescs");
+  for (std::vector<Type*>::const_iterator p = this->type_descriptors_.begin();
+       p != this->type_descriptors_.end();
+       ++p)
+    {
+      this->write_c_string(" ");
+      this->write_type(*p);
+    }
+  this->write_c_string(";\n");
 }
 
 // Export escape note.
@@ -57,7 +57,8 @@ enum Export_data_version {
   EXPORT_FORMAT_UNKNOWN = 0,
   EXPORT_FORMAT_V1 = 1,
   EXPORT_FORMAT_V2 = 2,
-  EXPORT_FORMAT_CURRENT = EXPORT_FORMAT_V2
+  EXPORT_FORMAT_V3 = 3,
+  EXPORT_FORMAT_CURRENT = EXPORT_FORMAT_V3
 };
 
 // This class manages exporting Go declarations.  It handles the main
@@ -119,9 +120,10 @@ class Export : public String_dump
   // Size of export data magic string (which includes version number).
   static const int magic_len = 4;
 
-  // Magic strings (current version and older v1 version).
+  // Magic strings (current version and older v1 and v2 versions).
   static const char cur_magic[magic_len];
   static const char v1_magic[magic_len];
+  static const char v2_magic[magic_len];
 
   // The length of the checksum string.
   static const int checksum_len = 20;
@@ -188,6 +190,12 @@ class Export : public String_dump
   void
   write_unsigned(unsigned);
 
+  // Return the unnamed types whose type descriptors this package
+  // promised to define.
+  const std::vector<Type*>&
+  type_descriptors() const
+  { return this->type_descriptors_; }
+
  private:
   Export(const Export&);
   Export& operator=(const Export&);
@@ -219,6 +227,10 @@ class Export : public String_dump
   void
   register_builtin_type(Gogo*, const char* name, Builtin_code);
 
+  // Write out the list of unnamed type descriptors we define.
+  void
+  write_type_descriptors();
+
   // Mapping from Type objects to a constant index.
   typedef Unordered_map(const Type*, int) Type_refs;
 
@@ -230,6 +242,10 @@ class Export : public String_dump
   int type_index_;
   // Packages we have written out.
   Unordered_set(const Package*) packages_;
+  // Unnamed types written out, in order.
+  std::vector<Type*> unnamed_types_;
+  // Unnamed types whose descriptors we promise to define.
+  std::vector<Type*> type_descriptors_;
 };
 
 // An export streamer which puts the export stream in a named section.
@@ -12,6 +12,7 @@
 #include "gogo.h"
 #include "go-diagnostics.h"
 #include "go-encode-id.h"
+#include "go-optimize.h"
 #include "types.h"
 #include "export.h"
 #include "import.h"
@@ -135,7 +136,7 @@ Expression::determine_type_no_context()
 // assignment.
 
 Expression*
-Expression::convert_for_assignment(Gogo*, Type* lhs_type,
+Expression::convert_for_assignment(Gogo* gogo, Type* lhs_type,
 				   Expression* rhs, Location location)
 {
   Type* rhs_type = rhs->type();
@@ -148,7 +149,8 @@ Expression::convert_for_assignment(Gogo*, Type* lhs_type,
   if (!are_identical && lhs_type->interface_type() != NULL)
     {
       if (rhs_type->interface_type() == NULL)
-        return Expression::convert_type_to_interface(lhs_type, rhs, location);
+        return Expression::convert_type_to_interface(gogo, lhs_type, rhs,
+                                                     false, location);
       else
         return Expression::convert_interface_to_interface(lhs_type, rhs, false,
                                                           location);
@@ -194,10 +196,12 @@ Expression::convert_for_assignment(Gogo*, Type* lhs_type,
 }
 
 // Return an expression for a conversion from a non-interface type to an
-// interface type.
+// interface type.  ON_STACK is true if the interface value does not
+// escape.
 
 Expression*
-Expression::convert_type_to_interface(Type* lhs_type, Expression* rhs,
+Expression::convert_type_to_interface(Gogo* gogo, Type* lhs_type,
+				      Expression* rhs, bool on_stack,
                                       Location location)
 {
   Interface_type* lhs_interface_type = lhs_type->interface_type();
@@ -242,16 +246,27 @@ Expression::convert_type_to_interface(Type* lhs_type, Expression* rhs,
 	  rhs_struct_type = rhs_type->deref()->struct_type();
 	  is_pointer = true;
 	}
+      Type* mtable_type = NULL;
       if (rhs_named_type != NULL)
-	first_field =
-	  rhs_named_type->interface_method_table(lhs_interface_type,
-                                                 is_pointer);
+	{
+	  first_field =
+	    rhs_named_type->interface_method_table(lhs_interface_type,
+						   is_pointer);
+	  mtable_type = rhs_named_type;
+	}
       else if (rhs_struct_type != NULL)
-	first_field =
-	  rhs_struct_type->interface_method_table(lhs_interface_type,
-                                                  is_pointer);
+	{
+	  first_field =
+	    rhs_struct_type->interface_method_table(lhs_interface_type,
+						    is_pointer);
+	  mtable_type = rhs_struct_type;
+	}
       else
 	first_field = Expression::make_nil(location);
+
+      if (mtable_type != NULL && first_field->unary_expression() != NULL)
+	gogo->record_static_itab(lhs_type, mtable_type, is_pointer,
+				 first_field);
     }
 
   Expression* obj;
@@ -261,12 +276,47 @@ Expression::convert_type_to_interface(Type* lhs_type, Expression* rhs,
       // holds the pointer itself.
       obj = rhs;
     }
+  else if (rhs->is_constant()
+	   || (rhs->is_composite_literal() && rhs->is_static_initializer()))
+    {
+      // The value can never be changed through the interface, so a
+      // constant, or a composite literal such as the zero value T{},
+      // can point at a read-only copy in static data.
+      obj = Expression::make_unary(OPERATOR_AND, rhs, location);
+    }
+  else if (rhs_type->integer_type() != NULL
+	   && rhs_type->integer_type()->bits() == 8)
+    {
+      // runtime.convT8 returns a pointer into a static table holding
+      // every byte value.
+      Type* uint8_type = Type::lookup_integer_type("uint8");
+      Expression* val = Expression::make_cast(uint8_type, rhs, location);
+      obj = Runtime::make_call(Runtime::CONVT8, location, 1, val);
+      obj = Expression::make_unsafe_cast(Type::make_pointer_type(rhs_type),
+					 obj, location);
+    }
+  else if (on_stack)
+    {
+      // The interface value does not escape, so the copy of the
+      // value can live on the stack.
+      obj = Expression::make_heap_expression(rhs, location);
+      obj->heap_expression()->set_allocate_on_stack();
+    }
+  else if (rhs_type->integer_type() != NULL
+	   && rhs_type->integer_type()->bits() == 64)
+    {
+      // runtime.convT64 returns a pointer into a static table for
+      // small values, and only allocates for large ones.
+      Type* uint64_type = Type::lookup_integer_type("uint64");
+      Expression* val = Expression::make_cast(uint64_type, rhs, location);
+      obj = Runtime::make_call(Runtime::CONVT64, location, 1, val);
+      obj = Expression::make_unsafe_cast(Type::make_pointer_type(rhs_type),
+					 obj, location);
+    }
   else
     {
       // We are assigning a non-pointer value to the interface; the
-      // interface gets a copy of the value in the heap if it escapes.
-      // TODO(cmang): Associate escape state state of RHS with newly
-      // created OBJ.
+      // interface gets a copy of the value in the heap.
       obj = Expression::make_heap_expression(rhs, location);
     }
 
@@ -357,6 +407,139 @@ Expression::convert_interface_to_interface(Type *lhs_type, Expression* rhs,
   return Expression::make_interface_value(lhs_type, first_field, obj, location);
 }
 
+// Type assertions to a non-empty interface type cache the last method
+// table they found, so that a site that keeps seeing the same dynamic
+// type only has to compare pointers.
+
+Go_optimize optimize_itab_cache_flag("itabcache", true);
+
+// Create the cache variable for a type assertion site.  It holds the
+// address of a method table, whose first word is the dynamic type.
+// It is a uintptr so that the garbage collector ignores it; method
+// tables are never allocated in the heap.
+
+static Named_object*
+make_itab_cache_var(Gogo* gogo, Location loc)
+{
+  Type* uintptr_type = Type::lookup_integer_type("uintptr");
+  Variable* var = new Variable(uintptr_type, NULL, true, false, false, loc);
+  return gogo->add_variable(gogo->itab_cache_name(), var);
+}
+
+// Return an expression that is true if CACHE_TEMP, the value loaded
+// from a cache variable, is a method table for the dynamic type
+// RHS_DESC.
+
+static Expression*
+itab_cache_hit(Temporary_statement* cache_temp, Expression* rhs_desc,
+	       Location loc)
+{
+  Type* uintptr_type = Type::lookup_integer_type("uintptr");
+  Expression* ref = Expression::make_temporary_reference(cache_temp, loc);
+  Expression* zero = Expression::make_integer_ul(0, uintptr_type, loc);
+  Expression* set = Expression::make_binary(OPERATOR_NOTEQ, ref, zero, loc);
+
+  Type* pdt = Type::make_pointer_type(Type::make_type_descriptor_ptr_type());
+  ref = Expression::make_temporary_reference(cache_temp, loc);
+  Expression* td = Expression::make_unsafe_cast(pdt, ref, loc);
+  td = Expression::make_dereference(td, Expression::NIL_CHECK_NOT_NEEDED,
+				    loc);
+  Expression* eq = Expression::make_binary(OPERATOR_EQEQ, td, rhs_desc, loc);
+
+  return Expression::make_binary(OPERATOR_ANDAND, set, eq, loc);
+}
+
+// Return an expression for the method table for converting a value
+// whose type descriptor is RHS_DESC, which must be a variable, to the
+// non-empty interface type LHS_TYPE, using a cache private to this
+// call site.  CODE is the runtime function to call when the cache
+// misses.  Set *PCACHE_TEMP to a temporary holding the cached value,
+// which must be evaluated before the result.
+
+static Expression*
+cached_itab_expression(Gogo* gogo, Type* lhs_type, Expression* rhs_desc,
+		       Runtime::Function code,
+		       Temporary_statement** pcache_temp, Location loc)
+{
+  go_assert(rhs_desc->is_variable());
+
+  // c := cache
+  Named_object* cache = make_itab_cache_var(gogo, loc);
+  Expression* ref = Expression::make_var_reference(cache, loc);
+  Temporary_statement* cache_temp =
+    Statement::make_temporary(ref->type(), ref, loc);
+  *pcache_temp = cache_temp;
+
+  // c != 0 && *(**_type)(c) == RHS_DESC
+  //   ? unsafe.Pointer(c)
+  //   : CODE(LHS_TYPE, RHS_DESC, &cache)
+  Expression* hit = itab_cache_hit(cache_temp, rhs_desc, loc);
+  Type* pvt = Type::make_pointer_type(Type::make_void_type());
+  Expression* cached = Expression::make_temporary_reference(cache_temp, loc);
+  cached = Expression::make_unsafe_cast(pvt, cached, loc);
+  ref = Expression::make_var_reference(cache, loc);
+  Expression* addr = Expression::make_unary(OPERATOR_AND, ref, loc);
+  Expression* td = Expression::make_type_descriptor(lhs_type, loc);
+  Expression* call = Runtime::make_call(code, loc, 3, td, rhs_desc->copy(),
+					addr);
+  return Expression::make_conditional(hit, cached, call, loc);
+}
+
+// Return an expression for the method table for converting a value
+// whose type descriptor is RHS_DESC to the non-empty interface type
+// LHS_TYPE, or nil if the conversion is not possible.
+
+Expression*
+Expression::make_cached_itab(Gogo* gogo, Type* lhs_type, Expression* rhs_desc,
+			     Block* b, Location loc)
+{
+  go_assert(!lhs_type->interface_type()->is_empty());
+  Temporary_statement* cache_temp;
+  Expression* ret = cached_itab_expression(gogo, lhs_type, rhs_desc,
+					   Runtime::IFACET2ITABCACHE,
+					   &cache_temp, loc);
+  b->add_statement(cache_temp);
+  return ret;
+}
+
+// Return whether to cache method tables at type assertion sites.
+
+bool
+Expression::use_itab_cache()
+{
+  return optimize_itab_cache_flag.is_enabled();
+}
+
+// Return an expression that is true if a value whose type descriptor
+// is RHS_DESC can be converted to the non-empty interface LHS_TYPE,
+// using a cache private to this call site.
+
+Expression*
+Expression::make_cached_interface_check(Gogo* gogo, Type* lhs_type,
+					Expression* rhs_desc, Block* b,
+					Location loc)
+{
+  go_assert(rhs_desc->is_variable());
+  go_assert(!lhs_type->interface_type()->is_empty());
+
+  // c := cache
+  Named_object* cache = make_itab_cache_var(gogo, loc);
+  Expression* ref = Expression::make_var_reference(cache, loc);
+  Temporary_statement* cache_temp =
+    Statement::make_temporary(ref->type(), ref, loc);
+  b->add_statement(cache_temp);
+
+  // c != 0 && *(**_type)(c) == RHS_DESC
+  //   || ifaceT2IpCache(LHS_TYPE, RHS_DESC, &cache)
+  Expression* hit = itab_cache_hit(cache_temp, rhs_desc, loc);
+  ref = Expression::make_var_reference(cache, loc);
+  Expression* addr = Expression::make_unary(OPERATOR_AND, ref, loc);
+  Expression* td = Expression::make_type_descriptor(lhs_type, loc);
+  Expression* call = Runtime::make_call(Runtime::IFACET2IPCACHE, loc, 3,
+					td, rhs_desc->copy(), addr);
+  return Expression::make_binary(OPERATOR_OROR, hit, call, loc);
+}
+
 // Return an expression for the conversion of an interface type to a
 // non-interface type.
 
@@ -3474,6 +3657,14 @@ Type_conversion_expression::do_get_backend(Translate_context* context)
       Bexpression* bexpr = this->expr_->get_backend(context);
       return gogo->backend()->convert_expression(btype, bexpr, loc);
     }
+  else if (type->interface_type() != NULL
+	   && expr_type->interface_type() == NULL)
+    {
+      Expression* conversion =
+	Expression::convert_type_to_interface(gogo, type, this->expr_,
+					      this->no_escape_, loc);
+      return conversion->get_backend(context);
+    }
   else if (type->interface_type() != NULL
 	   || expr_type->interface_type() != NULL)
     {
@@ -3668,6 +3859,93 @@ Unsafe_type_conversion_expression::do_copy()
 					       this->location());
 }
 
+// Flatten an unsafe type conversion.  Builtin_call_expression::lower_make
+// turns make([]T, len, cap) into a conversion of a call to makeslice.
+// If escape analysis has shown that the slice does not escape, and
+// the capacity is a small constant, we back the slice with a zeroed
+// stack array instead, as in
+//   var tmp [cap]T; tmp[0:len]
+// Growing the slice with append still works as usual: growslice
+// copies the elements into a new heap array once CAP is exceeded.
+
+Expression*
+Unsafe_type_conversion_expression::do_flatten(Gogo* gogo, Named_object*,
+					      Statement_inserter* inserter)
+{
+  Call_expression* call = this->expr_->call_expression();
+  if (call == NULL || !this->type_->is_slice_type())
+    return this;
+  Func_expression* fn = call->fn()->func_expression();
+  if (fn == NULL
+      || !fn->is_runtime_function()
+      || (fn->runtime_code() != Runtime::MAKESLICE
+	  && fn->runtime_code() != Runtime::MAKESLICE64))
+    return this;
+
+  Node* n = Node::make_node(call);
+  if ((n->encoding() & ESCAPE_MASK) != Node::ESCAPE_NONE)
+    return this;
+
+  Location loc = this->location();
+  Expression_list* args = call->args();
+  go_assert(args != NULL && args->size() == 3);
+  Expression* len = args->at(1);
+
+  // If the capacity was not given, it is the same temporary as the
+  // length; look through it, as Node::is_big does.
+  Expression* cap = args->at(2);
+  Temporary_reference_expression* tre = cap->temporary_reference_expression();
+  if (tre != NULL
+      && tre->statement() != NULL
+      && tre->statement()->init() != NULL)
+    cap = tre->statement()->init();
+
+  Numeric_constant nc;
+  unsigned long vcap;
+  if (!cap->numeric_constant_value(&nc)
+      || nc.to_unsigned_long(&vcap) != Numeric_constant::NC_UL_VALID)
+    {
+      if (gogo->debug_escape_level() != 0)
+	go_inform(loc, "make slice not allocated on stack: "
+		  "non-constant capacity");
+      return this;
+    }
+
+  Type* et = this->type_->array_type()->element_type();
+  int64_t esize;
+  if (!et->backend_type_size(gogo, &esize) || esize < 0)
+    return this;
+
+  // Use the same limit as escape analysis uses for other implicit
+  // allocations.  A slice with no capacity, or of zero sized
+  // elements, is backed by a zero sized stack array, which saves the
+  // call to makeslice.
+  const unsigned long max_stack_size = 1 << 16;
+  if (esize > 0
+      && vcap >= max_stack_size / static_cast<unsigned long>(esize))
+    {
+      if (gogo->debug_escape_level() != 0)
+	go_inform(loc, "make slice not allocated on stack: too large");
+      return this;
+    }
+
+  Type* int_type = Type::lookup_integer_type("int");
+  Expression* alen = Expression::make_integer_ul(vcap, int_type, loc);
+  Type* at = Type::make_array_type(et, alen);
+  Expression* zero = Expression::make_array_composite_literal(at, NULL, loc);
+  Temporary_statement* temp = Statement::make_temporary(at, zero, loc);
+  temp->set_is_address_taken();
+  inserter->insert(temp);
+
+  if (gogo->debug_escape_level() != 0)
+    go_inform(loc, "make slice allocated on stack");
+
+  Expression* ref = Expression::make_temporary_reference(temp, loc);
+  Expression* start = Expression::make_integer_ul(0, int_type, loc);
+  Expression* ret = Expression::make_array_index(ref, start, len, NULL, loc);
+  return Expression::make_unsafe_cast(this->type_, ret, loc);
+}
+
 // Convert to backend representation.
 
 Bexpression*
@@ -4015,6 +4293,12 @@ Unary_expression::base_is_static_initializer(Expression* expr)
   if (expr->string_expression() != NULL)
     return true;
 
+  // The address of a constant can be used as a static initializer.
+  // This can not be written in Go itself but this is used when
+  // converting a constant to an interface type.
+  if (expr->is_constant())
+    return true;
+
   return false;
 }
 
@@ -4479,9 +4763,10 @@ Unary_expression::do_get_backend(Translate_context* context)
 	      gogo->add_gc_root(Expression::make_backend(root, type, loc));
 	    }
 	}
-      else if ((this->expr_->is_composite_literal()
-		|| this->expr_->string_expression() != NULL)
-	       && this->expr_->is_static_initializer())
+      else if (((this->expr_->is_composite_literal()
+		 || this->expr_->string_expression() != NULL)
+		&& this->expr_->is_static_initializer())
+	       || this->expr_->is_constant())
         {
 	  std::string var_name(gogo->initializer_name());
 	  std::string asm_name(go_selectively_encode_id(var_name));
@@ -4831,6 +5116,14 @@ Binary_expression::compare_integer(const Numeric_constant* left_nc,
 				   const Numeric_constant* right_nc,
 				   int* cmp)
 {
+  long lval;
+  long rval;
+  if (left_nc->small_int_value(&lval) && right_nc->small_int_value(&rval))
+    {
+      *cmp = lval < rval ? -1 : (lval > rval ? 1 : 0);
+      return true;
+    }
+
   mpz_t left_val;
   if (!left_nc->to_int(&left_val))
     return false;
@@ -4999,6 +5292,25 @@ Binary_expression::eval_integer(Operator op, const Numeric_constant* left_nc,
 				const Numeric_constant* right_nc,
 				Location location, Numeric_constant* nc)
 {
+  bool is_rune = (left_nc->is_rune()
+		  || (op != OPERATOR_LSHIFT
+		      && op != OPERATOR_RSHIFT
+		      && right_nc->is_rune()));
+
+  long lval;
+  long rval;
+  long result;
+  if (left_nc->small_int_value(&lval)
+      && right_nc->small_int_value(&rval)
+      && Binary_expression::eval_small_integer(op, lval, rval, &result))
+    {
+      if (is_rune)
+	nc->set_rune_long(NULL, result);
+      else
+	nc->set_long(NULL, result);
+      return true;
+    }
+
   mpz_t left_val;
   if (!left_nc->to_int(&left_val))
     return false;
@@ -5119,10 +5431,7 @@ Binary_expression::eval_integer(Operator op, const Numeric_constant* left_nc,
   mpz_clear(left_val);
   mpz_clear(right_val);
 
-  if (left_nc->is_rune()
-      || (op != OPERATOR_LSHIFT
-	  && op != OPERATOR_RSHIFT
-	  && right_nc->is_rune()))
+  if (is_rune)
     nc->set_rune(NULL, val);
   else
     nc->set_int(NULL, val);
@@ -5132,6 +5441,97 @@ Binary_expression::eval_integer(Operator op, const Numeric_constant* left_nc,
   return true;
 }
 
+// Apply binary opcode OP to the integers LEFT and RIGHT using native
+// arithmetic, setting *RESULT.  Return false if the result might not
+// fit in a long, or if the operation needs an error message; the
+// caller then falls back to GMP.
+
+bool
+Binary_expression::eval_small_integer(Operator op, long left, long right,
+				      long* result)
+{
+  const int long_bits = sizeof(long) * CHAR_BIT;
+  switch (op)
+    {
+    case OPERATOR_PLUS:
+      if (right > 0 ? left > LONG_MAX - right : left < LONG_MIN - right)
+	return false;
+      *result = left + right;
+      return true;
+
+    case OPERATOR_MINUS:
+      if (right < 0 ? left > LONG_MAX + right : left < LONG_MIN + right)
+	return false;
+      *result = left - right;
+      return true;
+
+    case OPERATOR_MULT:
+      {
+	// Only multiply values whose product can not overflow.
+	const long limit = 1L << (long_bits / 2 - 1);
+	if (left <= -limit || left >= limit || right <= -limit
+	    || right >= limit)
+	  return false;
+	*result = left * right;
+	return true;
+      }
+
+    case OPERATOR_DIV:
+      if (right == 0 || (left == LONG_MIN && right == -1))
+	return false;
+      *result = left / right;
+      return true;
+
+    case OPERATOR_MOD:
+      if (right == 0 || (left == LONG_MIN && right == -1))
+	return false;
+      *result = left % right;
+      return true;
+
+    case OPERATOR_LSHIFT:
+      if (right < 0 || right >= long_bits - 1)
+	return false;
+      if (left < -(LONG_MAX >> right) - 1 || left > (LONG_MAX >> right))
+	return false;
+      *result = left * (1L << right);
+      return true;
+
+    case OPERATOR_RSHIFT:
+      if (right < 0)
+	return false;
+      if (right >= long_bits)
+	*result = left < 0 ? -1 : 0;
+      else if (left >= 0)
+	*result = left >> right;
+      else
+	{
+	  // Round toward negative infinity without relying on the
+	  // implementation defined right shift of negative values.
+	  *result = -((-(left + 1)) >> right) - 1;
+	}
+      return true;
+
+    case OPERATOR_OR:
+      *result = left | right;
+      return true;
+
+    case OPERATOR_XOR:
+      *result = left ^ right;
+      return true;
+
+    case OPERATOR_AND:
+      *result = left & right;
+      return true;
+
+    case OPERATOR_BITCLEAR:
+      *result = left & ~right;
+      return true;
+
+    default:
+      return false;
+    }
+}
+
 // Apply binary opcode OP to LEFT_NC and RIGHT_NC, setting NC, using
 // floating point operations.  Return true if this could be done,
 // false if not.
@@ -7094,7 +7494,11 @@ Bound_method_expression::do_flatten(Gogo* gogo, Named_object*,
 
   Node* n = Node::make_node(this);
   if ((n->encoding() & ESCAPE_MASK) == Node::ESCAPE_NONE)
-    ret->heap_expression()->set_allocate_on_stack();
+    {
+      ret->heap_expression()->set_allocate_on_stack();
+      if (gogo->debug_escape_level() != 0)
+	go_inform(loc, "method value closure allocated on stack");
+    }
   else if (gogo->compiling_runtime() && gogo->package_name() == "runtime")
     go_error_at(loc, "%s escapes to heap, not allowed in runtime",
                 n->ast_format(gogo).c_str());
@@ -7767,7 +8171,9 @@ Builtin_call_expression::flatten_append(Gogo* gogo, Named_object* function,
   //   growslice(type, s1tmp, ntmp) :
   //   s1tmp[:ntmp]
   // Using uint here means that if the computation of ntmp overflowed,
-  // we will call growslice which will panic.
+  // we will call growslice which will panic.  The condition is
+  // marked unlikely, so that the backend lays out the common case
+  // where the capacity suffices as the straight line path.
 
   Expression* left = Expression::make_temporary_reference(ntmp, loc);
   left = Expression::make_cast(uint_type, left, loc);
@@ -7780,6 +8186,7 @@ Builtin_call_expression::flatten_append(Gogo* gogo, Named_object* function,
   right = Expression::make_cast(uint_type, right, loc);
 
   Expression* cond = Expression::make_binary(OPERATOR_GT, left, right, loc);
+  cond = Gogo::make_unlikely(cond, loc);
 
   Expression* a1 = Expression::make_type_descriptor(element_type, loc);
   Expression* a2 = Expression::make_temporary_reference(s1tmp, loc);
@@ -7788,11 +8195,13 @@ Builtin_call_expression::flatten_append(Gogo* gogo, Named_object* function,
 					a1, a2, a3);
   call = Expression::make_unsafe_cast(slice_type, call, loc);
 
+  // This slice is only evaluated when ntmp <= cap(s1tmp), so it
+  // doesn't need a bounds check.
   ref = Expression::make_temporary_reference(s1tmp, loc);
   Expression* zero = Expression::make_integer_ul(0, int_type, loc);
   Expression* ref2 = Expression::make_temporary_reference(ntmp, loc);
-  // FIXME: Mark this index as not requiring bounds checks.
-  ref = Expression::make_index(ref, zero, ref2, NULL, loc);
+  ref = Expression::make_array_index(ref, zero, ref2, NULL, loc);
+  ref->array_index_expression()->set_needs_bounds_check(false);
 
   Expression* rhs = Expression::make_conditional(cond, call, ref, loc);
 
@@ -7803,14 +8212,42 @@ Builtin_call_expression::flatten_append(Gogo* gogo, Named_object* function,
   Statement* assign = Statement::make_assignment(lhs, rhs, loc);
   inserter->insert(assign);
 
-  if (this->is_varargs())
+  if (this->is_varargs() && !element_type->has_pointer())
+    {
+      // We know that the new elements fit, and they need no write
+      // barriers, so move them with a single call.
+      // memmove(&s1tmp[l1tmp], s2tmp.ptr, uintptr(l2tmp) * sizeof(T))
+      a1 = Expression::make_temporary_reference(s1tmp, loc);
+      ref = Expression::make_temporary_reference(l1tmp, loc);
+      a1 = Expression::make_array_index(a1, ref, NULL, NULL, loc);
+      a1->array_index_expression()->set_needs_bounds_check(false);
+      a1 = Expression::make_unary(OPERATOR_AND, a1, loc);
+
+      a2 = Expression::make_temporary_reference(s2tmp, loc);
+      if (a2->type()->is_string_type())
+	a2 = Expression::make_string_info(a2, STRING_INFO_DATA, loc);
+      else
+	a2 = Expression::make_slice_info(a2, SLICE_INFO_VALUE_POINTER, loc);
+
+      Type* uintptr_type = Type::lookup_integer_type("uintptr");
+      ref = Expression::make_temporary_reference(l2tmp, loc);
+      ref = Expression::make_cast(uintptr_type, ref, loc);
+      a3 = Expression::make_type_info(element_type, TYPE_INFO_SIZE);
+      a3 = Expression::make_binary(OPERATOR_MULT, ref, a3, loc);
+
+      call = Runtime::make_call(Runtime::MEMMOVE, loc, 3, a1, a2, a3);
+      gogo->lower_expression(function, inserter, &call);
+      gogo->flatten_expression(function, inserter, &call);
+      inserter->insert(Statement::make_statement(call, false));
+    }
+  else if (this->is_varargs())
     {
       // copy(s1tmp[l1tmp:], s2tmp)
       a1 = Expression::make_temporary_reference(s1tmp, loc);
       ref = Expression::make_temporary_reference(l1tmp, loc);
       Expression* nil = Expression::make_nil(loc);
-      // FIXME: Mark this index as not requiring bounds checks.
-      a1 = Expression::make_index(a1, ref, nil, NULL, loc);
+      a1 = Expression::make_array_index(a1, ref, nil, NULL, loc);
+      a1->array_index_expression()->set_needs_bounds_check(false);
 
       a2 = Expression::make_temporary_reference(s2tmp, loc);
 
@@ -7837,8 +8274,8 @@ Builtin_call_expression::flatten_append(Gogo* gogo, Named_object* function,
 	  ref2 = Expression::make_temporary_reference(l1tmp, loc);
 	  Expression* off = Expression::make_integer_ul(i, int_type, loc);
 	  ref2 = Expression::make_binary(OPERATOR_PLUS, ref2, off, loc);
-	  // FIXME: Mark this index as not requiring bounds checks.
-	  lhs = Expression::make_index(ref, ref2, NULL, NULL, loc);
+	  lhs = Expression::make_array_index(ref, ref2, NULL, NULL, loc);
+	  lhs->array_index_expression()->set_needs_bounds_check(false);
 	  gogo->lower_expression(function, inserter, &lhs);
 	  gogo->flatten_expression(function, inserter, &lhs);
 	  // The flatten pass runs after the write barrier pass, so we
@@ -9565,51 +10002,7 @@ Call_expression::do_lower(Gogo* gogo, Named_object* function,
   // object as the first parameter.
   Bound_method_expression* bme = this->fn_->bound_method_expression();
   if (bme != NULL)
-    {
-      Named_object* methodfn = bme->function();
-      Expression* first_arg = bme->first_argument();
-
-      // We always pass a pointer when calling a method.
-      if (first_arg->type()->points_to() == NULL
-	  && !first_arg->type()->is_error())
-	{
-	  first_arg = Expression::make_unary(OPERATOR_AND, first_arg, loc);
-	  // We may need to create a temporary variable so that we can
-	  // take the address.  We can't do that here because it will
-	  // mess up the order of evaluation.
-	  Unary_expression* ue = static_cast<Unary_expression*>(first_arg);
-	  ue->set_create_temp();
-	}
-
-      // If we are calling a method which was inherited from an
-      // embedded struct, and the method did not get a stub, then the
-      // first type may be wrong.
-      Type* fatype = bme->first_argument_type();
-      if (fatype != NULL)
-	{
-	  if (fatype->points_to() == NULL)
-	    fatype = Type::make_pointer_type(fatype);
-	  first_arg = Expression::make_unsafe_cast(fatype, first_arg, loc);
-	}
-
-      Expression_list* new_args = new Expression_list();
-      new_args->push_back(first_arg);
-      if (this->args_ != NULL)
-	{
-	  for (Expression_list::const_iterator p = this->args_->begin();
-	       p != this->args_->end();
-	       ++p)
-	    new_args->push_back(*p);
-	}
-
-      // We have to change in place because this structure may be
-      // referenced by Call_result_expressions.  We can't delete the
-      // old arguments, because we may be traversing them up in some
-      // caller.  FIXME.
-      this->args_ = new_args;
-      this->fn_ = Expression::make_func_reference(methodfn, NULL,
-						  bme->location());
-    }
+    this->lower_method_call(bme);
 
   // Handle a couple of special runtime functions.  In the runtime
   // package, getcallerpc returns the PC of the caller, and
@@ -9653,6 +10046,78 @@ Call_expression::do_lower(Gogo* gogo, Named_object* function,
   return this;
 }
 
+// Change a call to the method BME into a direct call to the method
+// function, passing the receiver as the first argument.
+
+void
+Call_expression::lower_method_call(Bound_method_expression* bme)
+{
+  Location loc = this->location();
+  Named_object* methodfn = bme->function();
+  Expression* first_arg = bme->first_argument();
+
+  // We always pass a pointer when calling a method.
+  if (first_arg->type()->points_to() == NULL
+      && !first_arg->type()->is_error())
+    {
+      first_arg = Expression::make_unary(OPERATOR_AND, first_arg, loc);
+      // We may need to create a temporary variable so that we can
+      // take the address.  We can't do that here because it will
+      // mess up the order of evaluation.
+      Unary_expression* ue = static_cast<Unary_expression*>(first_arg);
+      ue->set_create_temp();
+    }
+
+  // If we are calling a method which was inherited from an
+  // embedded struct, and the method did not get a stub, then the
+  // first type may be wrong.
+  Type* fatype = bme->first_argument_type();
+  if (fatype != NULL)
+    {
+      if (fatype->points_to() == NULL)
+	fatype = Type::make_pointer_type(fatype);
+      first_arg = Expression::make_unsafe_cast(fatype, first_arg, loc);
+    }
+
+  Expression_list* new_args = new Expression_list();
+  new_args->push_back(first_arg);
+  if (this->args_ != NULL)
+    {
+      for (Expression_list::const_iterator p = this->args_->begin();
+	   p != this->args_->end();
+	   ++p)
+	new_args->push_back(*p);
+    }
+
+  // We have to change in place because this structure may be
+  // referenced by Call_result_expressions.  We can't delete the
+  // old arguments, because we may be traversing them up in some
+  // caller.  FIXME.
+  this->args_ = new_args;
+  this->fn_ = Expression::make_func_reference(methodfn, NULL,
+					      bme->location());
+}
+
+// Change a call through an interface method into a direct call to
+// the method of TYPE, the dynamic type of the interface value, bound
+// to RECEIVER.  Return false if this can not be done.
+
+bool
+Call_expression::devirtualize(Gogo* gogo, Type* type, Expression* receiver)
+{
+  Interface_field_reference_expression* ifre =
+    this->fn_->interface_field_reference_expression();
+  go_assert(ifre != NULL);
+  Expression* fn = Type::bind_field_or_method(gogo, type, receiver,
+					      ifre->name(), ifre->location());
+  Bound_method_expression* bme = fn->bound_method_expression();
+  if (bme == NULL)
+    return false;
+  this->fn_ = bme;
+  this->lower_method_call(bme);
+  return true;
+}
+
 // Lower a call to a varargs function.  FUNCTION is the function in
 // which the call occurs--it's not the function we are calling.
 // VARARGS_TYPE is the type of the varargs parameter, a slice type.
@@ -10693,6 +11158,27 @@ Expression::make_index(Expression* left, Expression* start, Expression* end,
 
 // Class Array_index_expression.
 
+// Copy an array index expression, preserving what we know about the
+// bounds check.
+
+Expression*
+Array_index_expression::do_copy()
+{
+  Expression* ret =
+    Expression::make_array_index(this->array_->copy(),
+				 this->start_->copy(),
+				 (this->end_ == NULL
+				  ? NULL
+				  : this->end_->copy()),
+				 (this->cap_ == NULL
+				  ? NULL
+				  : this->cap_->copy()),
+				 this->location());
+  if (!this->needs_bounds_check_)
+    ret->array_index_expression()->set_needs_bounds_check(false);
+  return ret;
+}
+
 // Array index traversal.
 
 int
@@ -11079,10 +11565,12 @@ Array_index_expression::do_get_backend(Translate_context* context)
   if (this->end_ == NULL)
     {
       // Simple array indexing.  This has to return an l-value, so
-      // wrap the index check into START.
-      start =
-        gogo->backend()->conditional_expression(bfn, int_btype, bad_index,
-						crash, start, loc);
+      // wrap the index check into START.  If the index is known to be
+      // in bounds, skip the check.
+      if (this->needs_bounds_check_)
+	start =
+	  gogo->backend()->conditional_expression(bfn, int_btype, bad_index,
+						  crash, start, loc);
 
       Bexpression* ret;
       if (array_type->length() != NULL)
@@ -11184,6 +11672,8 @@ Array_index_expression::do_get_backend(Translate_context* context)
 
   Bexpression* ctor =
     gogo->backend()->constructor_expression(struct_btype, init, loc);
+  if (!this->needs_bounds_check_)
+    return ctor;
   return gogo->backend()->conditional_expression(bfn, struct_btype, bad_index,
 						 crash, ctor, loc);
 }
@@ -11210,6 +11700,24 @@ Expression::make_array_index(Expression* array, Expression* start,
 
 // Class String_index_expression.
 
+// Copy a string index expression, preserving what we know about the
+// bounds check.
+
+Expression*
+String_index_expression::do_copy()
+{
+  Expression* ret =
+    Expression::make_string_index(this->string_->copy(),
+				  this->start_->copy(),
+				  (this->end_ == NULL
+				   ? NULL
+				   : this->end_->copy()),
+				  this->location());
+  if (!this->needs_bounds_check_)
+    ret->string_index_expression()->set_needs_bounds_check(false);
+  return ret;
+}
+
 // String index traversal.
 
 int
@@ -11420,6 +11928,9 @@ String_index_expression::do_get_backend(Translate_context* context)
       Bexpression* index = 
 	gogo->backend()->indirect_expression(ubtype, ptr, true, loc);
 
+      if (!this->needs_bounds_check_)
+	return index;
+
       Btype* byte_btype = bytes->type()->points_to()->get_backend(gogo);
       Bexpression* index_error = bad_index->get_backend(context);
       return gogo->backend()->conditional_expression(bfn, byte_btype,
@@ -11441,6 +11952,8 @@ String_index_expression::do_get_backend(Translate_context* context)
   Expression* strslice = Runtime::make_call(Runtime::STRING_SLICE, loc, 3,
                                             string_arg, start, end);
   Bexpression* bstrslice = strslice->get_backend(context);
+  if (!this->needs_bounds_check_)
+    return bstrslice;
 
   Btype* str_btype = strslice->type()->get_backend(gogo);
   Bexpression* index_error = bad_index->get_backend(context);
@@ -12126,11 +12639,17 @@ Interface_field_reference_expression::do_get_backend(Translate_context* context)
   vals->push_back(Expression::make_func_code_reference(thunk, loc));
   vals->push_back(this->expr_);
 
+  Gogo* gogo = context->gogo();
   Expression* expr = Expression::make_struct_composite_literal(st, vals, loc);
-  Bexpression* bclosure =
-    Expression::make_heap_expression(expr, loc)->get_backend(context);
+  Expression* heap = Expression::make_heap_expression(expr, loc);
+  if (this->allocate_on_stack_)
+    {
+      heap->heap_expression()->set_allocate_on_stack();
+      if (gogo->debug_escape_level() != 0)
+	go_inform(loc, "method value closure allocated on stack");
+    }
+  Bexpression* bclosure = heap->get_backend(context);
 
-  Gogo* gogo = context->gogo();
   Btype* btype = this->type()->get_backend(gogo);
   bclosure = gogo->backend()->convert_expression(btype, bclosure, loc);
 
@@ -13353,7 +13872,9 @@ Map_construction_expression::do_traverse(Traverse* traverse)
 }
 
 // Flatten constructor initializer into a temporary variable since
-// we need to take its address for __go_construct_map.
+// we need to take its address for __go_construct_map.  If all the keys
+// and values are constant, the initializer is instead laid out once in
+// read-only static data.
 
 Expression*
 Map_construction_expression::do_flatten(Gogo* gogo, Named_object*,
@@ -13362,7 +13883,8 @@ Map_construction_expression::do_flatten(Gogo* gogo, Named_object*,
   if (!this->is_error_expression()
       && this->vals_ != NULL
       && !this->vals_->empty()
-      && this->constructor_temp_ == NULL)
+      && this->constructor_temp_ == NULL
+      && this->static_constructor_ == NULL)
     {
       Map_type* mt = this->type_->map_type();
       Type* key_type = mt->key_type();
@@ -13426,6 +13948,13 @@ Map_construction_expression::do_flatten(Gogo* gogo, Named_object*,
           new Fixed_array_construction_expression(ctor_type, NULL,
                                                   value_pairs, loc);
 
+      if (constructor->is_static_initializer())
+	{
+	  // There is no need to build the entries at run time.
+	  this->static_constructor_ = constructor;
+	  return this;
+	}
+
       this->constructor_temp_ =
           Statement::make_temporary(NULL, constructor, loc);
       constructor->issue_nil_check();
@@ -13517,6 +14046,15 @@ Map_construction_expression::do_get_backend(Translate_context* context)
   Expression* ventries;
   if (this->vals_ == NULL || this->vals_->empty())
     ventries = Expression::make_nil(loc);
+  else if (this->static_constructor_ != NULL)
+    {
+      i = this->vals_->size() / 2;
+
+      // Taking the address of a static initializer refers to a
+      // read-only variable.
+      ventries = Expression::make_unary(OPERATOR_AND,
+					this->static_constructor_, loc);
+    }
   else
     {
       go_assert(this->constructor_temp_ != NULL);
@@ -14320,7 +14858,7 @@ Type_guard_expression::do_traverse(Traverse* traverse)
 }
 
 Expression*
-Type_guard_expression::do_flatten(Gogo*, Named_object*,
+Type_guard_expression::do_flatten(Gogo* gogo, Named_object* function,
                                   Statement_inserter* inserter)
 {
   if (this->expr_->is_error_expression()
@@ -14338,6 +14876,39 @@ Type_guard_expression::do_flatten(Gogo*, Named_object*,
       this->expr_ =
           Expression::make_temporary_reference(temp, this->location());
     }
+
+  // For an assertion to a non-empty interface type, check the method
+  // table cached at this site before calling the runtime.
+  Interface_type* itype = this->type_->interface_type();
+  if (itype != NULL
+      && !itype->is_empty()
+      && function != NULL
+      && Expression::use_itab_cache()
+      && !Type::are_identical(this->type_, this->expr_->type(), false, NULL))
+    {
+      Location loc = this->location();
+
+      // desc := type descriptor of EXPR
+      Expression* desc = Expression::get_interface_type_descriptor(this->expr_);
+      Temporary_statement* desc_temp =
+	Statement::make_temporary(Type::make_type_descriptor_ptr_type(),
+				  desc, loc);
+      inserter->insert(desc_temp);
+
+      // itab := cached method table, or assertitabCache(TYPE, desc, &cache)
+      desc = Expression::make_temporary_reference(desc_temp, loc);
+      Temporary_statement* cache_temp;
+      Expression* itab = cached_itab_expression(gogo, this->type_, desc,
+						Runtime::ASSERTITABCACHE,
+						&cache_temp, loc);
+      inserter->insert(cache_temp);
+
+      Expression* obj =
+	Expression::make_interface_info(this->expr_, INTERFACE_INFO_OBJECT,
+					loc);
+      return Expression::make_interface_value(this->type_, itab, obj, loc);
+    }
+
   return this;
 }
 
@@ -14468,8 +15039,14 @@ Heap_expression::do_get_backend(Translate_context* context)
   // If this assignment needs a write barrier, call typedmemmove.  We
   // don't do this in the write barrier pass because in some cases
   // backend conversion can introduce new Heap_expression values.
+  // The space was just allocated, so it holds no old pointers for the
+  // barrier to shade.  A static initializer only holds pointers to
+  // static data, which the barrier does not need to shade either, so
+  // it can be stored directly.
   Bstatement* assn;
-  if (!etype->has_pointer() || this->allocate_on_stack_)
+  if (!etype->has_pointer()
+      || this->allocate_on_stack_
+      || this->expr_->is_static_initializer())
     {
       space = gogo->backend()->var_expression(space_temp, loc);
       Bexpression* ref =
@@ -14487,6 +15064,14 @@ Heap_expression::do_get_backend(Translate_context* context)
 							      loc);
       Bexpression* addr = gogo->backend()->address_expression(btempref, loc);
 
+      // When write barriers are not enabled, just copy the value.
+      space = gogo->backend()->var_expression(space_temp, loc);
+      Bexpression* ref =
+	gogo->backend()->indirect_expression(expr_btype, space, true, loc);
+      btempref = gogo->backend()->var_expression(btemp, loc);
+      Bstatement* plain =
+	gogo->backend()->assignment_statement(fndecl, ref, btempref, loc);
+
       Expression* td = Expression::make_type_descriptor(etype, loc);
       Type* etype_ptr = Type::make_pointer_type(etype);
       space = gogo->backend()->var_expression(space_temp, loc);
@@ -14496,6 +15081,23 @@ Heap_expression::do_get_backend(Translate_context* context)
 					    td, elhs, erhs);
       Bexpression* bcall = call->get_backend(context);
       Bstatement* s = gogo->backend()->expression_statement(fndecl, bcall);
+
+      std::vector<Bvariable*> vars;
+      std::vector<Bstatement*> stmts;
+      Bblock* then_block = gogo->backend()->block(fndecl, context->bblock(),
+						  vars, loc, loc);
+      stmts.push_back(s);
+      gogo->backend()->block_add_statements(then_block, stmts);
+      Bblock* else_block = gogo->backend()->block(fndecl, context->bblock(),
+						  vars, loc, loc);
+      stmts.clear();
+      stmts.push_back(plain);
+      gogo->backend()->block_add_statements(else_block, stmts);
+
+      Expression* enabled = gogo->write_barrier_enabled(loc);
+      Bexpression* benabled = enabled->get_backend(context);
+      s = gogo->backend()->if_statement(fndecl, benabled, then_block,
+					else_block, loc);
       assn = gogo->backend()->compound_statement(edecl, s);
     }
   decl = gogo->backend()->compound_statement(decl, assn);
@@ -16079,7 +16681,8 @@ Numeric_constant::~Numeric_constant()
 // Copy constructor.
 
 Numeric_constant::Numeric_constant(const Numeric_constant& a)
-  : classification_(a.classification_), type_(a.type_)
+  : classification_(a.classification_), is_small_(a.is_small_),
+    type_(a.type_)
 {
   switch (a.classification_)
     {
@@ -16087,7 +16690,10 @@ Numeric_constant::Numeric_constant(const Numeric_constant& a)
       break;
     case NC_INT:
     case NC_RUNE:
-      mpz_init_set(this->u_.int_val, a.u_.int_val);
+      if (a.is_small_)
+	this->u_.small_val = a.u_.small_val;
+      else
+	mpz_init_set(this->u_.int_val, a.u_.int_val);
       break;
     case NC_FLOAT:
       mpfr_init_set(this->u_.float_val, a.u_.float_val, GMP_RNDN);
@@ -16108,6 +16714,7 @@ Numeric_constant::operator=(const Numeric_constant& a)
 {
   this->clear();
   this->classification_ = a.classification_;
+  this->is_small_ = a.is_small_;
   this->type_ = a.type_;
   switch (a.classification_)
     {
@@ -16115,7 +16722,10 @@ Numeric_constant::operator=(const Numeric_constant& a)
       break;
     case NC_INT:
     case NC_RUNE:
-      mpz_init_set(this->u_.int_val, a.u_.int_val);
+      if (a.is_small_)
+	this->u_.small_val = a.u_.small_val;
+      else
+	mpz_init_set(this->u_.int_val, a.u_.int_val);
       break;
     case NC_FLOAT:
       mpfr_init_set(this->u_.float_val, a.u_.float_val, GMP_RNDN);
@@ -16141,7 +16751,8 @@ Numeric_constant::clear()
       break;
     case NC_INT:
     case NC_RUNE:
-      mpz_clear(this->u_.int_val);
+      if (!this->is_small_)
+	mpz_clear(this->u_.int_val);
       break;
     case NC_FLOAT:
       mpfr_clear(this->u_.float_val);
@@ -16153,6 +16764,7 @@ Numeric_constant::clear()
       go_unreachable();
     }
   this->classification_ = NC_INVALID;
+  this->is_small_ = false;
 }
 
 // Set to an unsigned long value.
@@ -16160,10 +16772,15 @@ Numeric_constant::clear()
 void
 Numeric_constant::set_unsigned_long(Type* type, unsigned long val)
 {
-  this->clear();
-  this->classification_ = NC_INT;
-  this->type_ = type;
-  mpz_init_set_ui(this->u_.int_val, val);
+  if (val <= static_cast<unsigned long>(LONG_MAX))
+    this->set_small(NC_INT, type, static_cast<long>(val));
+  else
+    {
+      this->clear();
+      this->classification_ = NC_INT;
+      this->type_ = type;
+      mpz_init_set_ui(this->u_.int_val, val);
+    }
 }
 
 // Set to an integer value.
@@ -16171,21 +16788,61 @@ Numeric_constant::set_unsigned_long(Type* type, unsigned long val)
 void
 Numeric_constant::set_int(Type* type, const mpz_t val)
 {
-  this->clear();
-  this->classification_ = NC_INT;
-  this->type_ = type;
-  mpz_init_set(this->u_.int_val, val);
+  this->set_mpz(NC_INT, type, val);
 }
 
 // Set to a rune value.
 
 void
 Numeric_constant::set_rune(Type* type, const mpz_t val)
+{
+  this->set_mpz(NC_RUNE, type, val);
+}
+
+// Set to an integer value that fits in a long.
+
+void
+Numeric_constant::set_long(Type* type, long val)
+{
+  this->set_small(NC_INT, type, val);
+}
+
+// Set to a rune value that fits in a long.
+
+void
+Numeric_constant::set_rune_long(Type* type, long val)
+{
+  this->set_small(NC_RUNE, type, val);
+}
+
+// Set to an integer or rune value held in a long.
+
+void
+Numeric_constant::set_small(Classification classification, Type* type,
+			    long val)
 {
   this->clear();
-  this->classification_ = NC_RUNE;
+  this->classification_ = classification;
+  this->is_small_ = true;
   this->type_ = type;
-  mpz_init_set(this->u_.int_val, val);
+  this->u_.small_val = val;
+}
+
+// Set to an integer or rune value, keeping it in a long if it fits.
+
+void
+Numeric_constant::set_mpz(Classification classification, Type* type,
+			  const mpz_t val)
+{
+  if (mpz_fits_slong_p(val))
+    this->set_small(classification, type, mpz_get_si(val));
+  else
+    {
+      this->clear();
+      this->classification_ = classification;
+      this->type_ = type;
+      mpz_init_set(this->u_.int_val, val);
+    }
 }
 
 // Set to a floating point value.
@@ -16281,7 +16938,10 @@ void
 Numeric_constant::get_int(mpz_t* val) const
 {
   go_assert(this->is_int());
-  mpz_init_set(*val, this->u_.int_val);
+  if (this->is_small_)
+    mpz_init_set_si(*val, this->u_.small_val);
+  else
+    mpz_init_set(*val, this->u_.int_val);
 }
 
 // Get a rune value.
@@ -16290,7 +16950,10 @@ void
 Numeric_constant::get_rune(mpz_t* val) const
 {
   go_assert(this->is_rune());
-  mpz_init_set(*val, this->u_.int_val);
+  if (this->is_small_)
+    mpz_init_set_si(*val, this->u_.small_val);
+  else
+    mpz_init_set(*val, this->u_.int_val);
 }
 
 // Get a floating point value.
@@ -16321,6 +16984,13 @@ Numeric_constant::to_unsigned_long(unsigned long* val) const
     {
     case NC_INT:
     case NC_RUNE:
+      if (this->is_small_)
+	{
+	  if (this->u_.small_val < 0)
+	    return NC_UL_NEGATIVE;
+	  *val = static_cast<unsigned long>(this->u_.small_val);
+	  return NC_UL_VALID;
+	}
       return this->mpz_to_unsigned_long(this->u_.int_val, val);
     case NC_FLOAT:
       return this->mpfr_to_unsigned_long(this->u_.float_val, val);
@@ -16374,6 +17044,13 @@ Numeric_constant::to_memory_size(int64_t* val) const
     {
     case NC_INT:
     case NC_RUNE:
+      if (this->is_small_)
+	{
+	  if (this->u_.small_val < 0)
+	    return false;
+	  *val = static_cast<int64_t>(this->u_.small_val);
+	  return true;
+	}
       return this->mpz_to_memory_size(this->u_.int_val, val);
     case NC_FLOAT:
       return this->mpfr_to_memory_size(this->u_.float_val, val);
@@ -16441,7 +17118,10 @@ Numeric_constant::to_int(mpz_t* val) const
     {
     case NC_INT:
     case NC_RUNE:
-      mpz_init_set(*val, this->u_.int_val);
+      if (this->is_small_)
+	mpz_init_set_si(*val, this->u_.small_val);
+      else
+	mpz_init_set(*val, this->u_.int_val);
       return true;
     case NC_FLOAT:
       if (!mpfr_integer_p(this->u_.float_val))
@@ -16470,7 +17150,10 @@ Numeric_constant::to_float(mpfr_t* val) const
     {
     case NC_INT:
     case NC_RUNE:
-      mpfr_init_set_z(*val, this->u_.int_val, GMP_RNDN);
+      if (this->is_small_)
+	mpfr_init_set_si(*val, this->u_.small_val, GMP_RNDN);
+      else
+	mpfr_init_set_z(*val, this->u_.int_val, GMP_RNDN);
       return true;
     case NC_FLOAT:
       mpfr_init_set(*val, this->u_.float_val, GMP_RNDN);
@@ -16495,7 +17178,10 @@ Numeric_constant::to_complex(mpc_t* val) const
     {
     case NC_INT:
     case NC_RUNE:
-      mpc_set_z(*val, this->u_.int_val, MPC_RNDNN);
+      if (this->is_small_)
+	mpc_set_si(*val, this->u_.small_val, MPC_RNDNN);
+      else
+	mpc_set_z(*val, this->u_.int_val, MPC_RNDNN);
       return true;
     case NC_FLOAT:
       mpc_set_fr(*val, this->u_.float_val, MPC_RNDNN);
@@ -16563,6 +17249,18 @@ bool
 Numeric_constant::check_int_type(Integer_type* type, bool issue_error,
 				 Location location)
 {
+  if (this->is_small_)
+    {
+      bool ret = Numeric_constant::long_fits_int_type(this->u_.small_val,
+						      type);
+      if (!ret && issue_error)
+	{
+	  go_error_at(location, "integer constant overflow");
+	  this->set_invalid();
+	}
+      return ret;
+    }
+
   mpz_t val;
   switch (this->classification_)
     {
@@ -16640,6 +17338,29 @@ Numeric_constant::check_int_type(Integer_type* type, bool issue_error,
   return ret;
 }
 
+// Return whether VAL can be represented in the integer type TYPE.
+
+bool
+Numeric_constant::long_fits_int_type(long val, Integer_type* type)
+{
+  if (type->is_abstract())
+    return true;
+  int bits = type->bits();
+  int long_bits = sizeof(long) * CHAR_BIT;
+  if (type->is_unsigned())
+    {
+      if (val < 0)
+	return false;
+      if (bits >= long_bits)
+	return true;
+      return (static_cast<unsigned long>(val) >> bits) == 0;
+    }
+  if (bits >= long_bits)
+    return true;
+  long limit = 1L << (bits - 1);
+  return val >= -limit && val < limit;
+}
+
 // Check whether the constant can be expressed in a floating point
 // type.
 
@@ -16652,7 +17373,10 @@ Numeric_constant::check_float_type(Float_type* type, bool issue_error,
     {
     case NC_INT:
     case NC_RUNE:
-      mpfr_init_set_z(val, this->u_.int_val, GMP_RNDN);
+      if (this->is_small_)
+	mpfr_init_set_si(val, this->u_.small_val, GMP_RNDN);
+      else
+	mpfr_init_set_z(val, this->u_.int_val, GMP_RNDN);
       break;
 
     case NC_FLOAT:
@@ -16765,7 +17489,10 @@ Numeric_constant::check_complex_type(Complex_type* type, bool issue_error,
     {
     case NC_INT:
     case NC_RUNE:
-      mpc_set_z(val, this->u_.int_val, MPC_RNDNN);
+      if (this->is_small_)
+	mpc_set_si(val, this->u_.small_val, MPC_RNDNN);
+      else
+	mpc_set_z(val, this->u_.int_val, MPC_RNDNN);
       break;
 
     case NC_FLOAT:
@@ -16842,8 +17569,19 @@ Numeric_constant::expression(Location loc) const
   switch (this->classification_)
     {
     case NC_INT:
+      if (this->is_small_)
+	return Expression::make_integer_sl(this->u_.small_val, this->type_,
+					   loc);
       return Expression::make_integer_z(&this->u_.int_val, this->type_, loc);
     case NC_RUNE:
+      if (this->is_small_)
+	{
+	  mpz_t val;
+	  mpz_init_set_si(val, this->u_.small_val);
+	  Expression* ret = Expression::make_character(&val, this->type_, loc);
+	  mpz_clear(val);
+	  return ret;
+	}
       return Expression::make_character(&this->u_.int_val, this->type_, loc);
     case NC_FLOAT:
       return Expression::make_float(&this->u_.float_val, this->type_, loc);
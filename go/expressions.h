@@ -988,6 +988,36 @@ class Expression
                                  Expression* rhs, bool for_type_guard,
                                  Location);
 
+  // Return an expression for the type descriptor of the dynamic type
+  // of the interface value RHS, which must be a variable.  This is nil
+  // for a nil interface value.
+  static Expression*
+  get_interface_type_descriptor(Expression* rhs);
+
+  // Return a boolean expression that is true if a value whose type
+  // descriptor is RHS_DESC, which must be a variable, can be
+  // converted to the non-empty interface type LHS_TYPE.  The last
+  // method table found is cached at the call site, so that testing
+  // the same dynamic type again just compares pointers.  This adds
+  // statements to B.  Only call this if use_itab_cache returns true.
+  static Expression*
+  make_cached_interface_check(Gogo*, Type* lhs_type, Expression* rhs_desc,
+			      Block* b, Location);
+
+  // Return an expression for the method table for converting a value
+  // whose type descriptor is RHS_DESC, which must be a variable, to
+  // the non-empty interface type LHS_TYPE, or nil if the conversion is
+  // not possible.  Like make_cached_interface_check, this uses a cache
+  // private to the call site and adds statements to B.
+  static Expression*
+  make_cached_itab(Gogo*, Type* lhs_type, Expression* rhs_desc, Block* b,
+		   Location);
+
+  // Return whether type assertions to non-empty interface types
+  // should cache the method table at each site.
+  static bool
+  use_itab_cache();
+
   // Return a backend expression implementing the comparison LEFT OP RIGHT.
   // TYPE is the type of both sides.
   static Bexpression*
@@ -1143,6 +1173,13 @@ class Expression
     SLICE_STORAGE_DOES_NOT_ESCAPE
   };
 
+  // For children to call to convert a non-interface value to an
+  // interface type.  ON_STACK is true if the value is known not to
+  // escape, so that any copy may be allocated on the stack.
+  static Expression*
+  convert_type_to_interface(Gogo*, Type*, Expression*, bool on_stack,
+			    Location);
+
  private:
   // Convert to the desired statement classification, or return NULL.
   // This is a controlled dynamic cast.
@@ -1166,12 +1203,6 @@ class Expression
 	    : NULL);
   }
 
-  static Expression*
-  convert_type_to_interface(Type*, Expression*, Location);
-
-  static Expression*
-  get_interface_type_descriptor(Expression*);
-
   static Expression*
   convert_interface_to_type(Type*, Expression*, Location);
 
@@ -1606,7 +1637,8 @@ class Type_conversion_expression : public Expression
   Type_conversion_expression(Type* type, Expression* expr,
 			     Location location)
     : Expression(EXPRESSION_CONVERSION, location),
-      type_(type), expr_(expr), may_convert_function_types_(false)
+      type_(type), expr_(expr), may_convert_function_types_(false),
+      no_escape_(false)
   { }
 
   // Return the type to which we are converting.
@@ -1627,6 +1659,12 @@ class Type_conversion_expression : public Expression
     this->may_convert_function_types_ = true;
   }
 
+  // Note that the result of a conversion to an interface type does
+  // not escape, so the copy of the value may live on the stack.
+  void
+  set_no_escape()
+  { this->no_escape_ = true; }
+
   // Import a type conversion expression.
   static Expression*
   do_import(Import*);
@@ -1683,6 +1721,8 @@ class Type_conversion_expression : public Expression
   // True if this is permitted to convert function types.  This is
   // used internally for method expressions.
   bool may_convert_function_types_;
+  // True if the value converted to an interface does not escape.
+  bool no_escape_;
 };
 
 // An unsafe type conversion, used to pass values to builtin functions.
@@ -1718,6 +1758,9 @@ class Unsafe_type_conversion_expression : public Expression
   Expression*
   do_copy();
 
+  Expression*
+  do_flatten(Gogo*, Named_object*, Statement_inserter*);
+
   Bexpression*
   do_get_backend(Translate_context*);
 
@@ -1813,6 +1856,11 @@ class Unary_expression : public Expression
       this->issue_nil_check_ = NIL_CHECK_NOT_NEEDED;
   }
 
+  // Return a determination as to whether this dereference expression
+  // requires a nil check.
+  Nil_check_classification
+  requires_nil_check(Gogo*);
+
  protected:
   int
   do_traverse(Traverse* traverse)
@@ -1877,11 +1925,6 @@ class Unary_expression : public Expression
   static bool
   base_is_static_initializer(Expression*);
 
-  // Return a determination as to whether this dereference expression
-  // requires a nil check.
-  Nil_check_classification
-  requires_nil_check(Gogo*);
-
   // The unary operator to apply.
   Operator op_;
   // Normally true.  False if this is an address expression which does
@@ -2019,6 +2062,9 @@ class Binary_expression : public Expression
   eval_integer(Operator op, const Numeric_constant*, const Numeric_constant*,
 	       Location, Numeric_constant*);
 
+  static bool
+  eval_small_integer(Operator op, long, long, long*);
+
   static bool
   eval_float(Operator op, const Numeric_constant*, const Numeric_constant*,
 	     Location, Numeric_constant*);
@@ -2238,6 +2284,12 @@ class Call_expression : public Expression
   set_is_multi_value_arg()
   { this->is_multi_value_arg_ = true; }
 
+  // Call the method of TYPE bound to RECEIVER directly, rather than
+  // through the interface method table.  Returns false if that is
+  // not possible.
+  bool
+  devirtualize(Gogo*, Type* type, Expression* receiver);
+
   // Whether this is a call to builtin function.
   virtual bool
   is_builtin()
@@ -2311,6 +2363,9 @@ class Call_expression : public Expression
   Expression*
   lower_to_builtin(Named_object**, const char*, int);
 
+  void
+  lower_method_call(Bound_method_expression*);
+
   Expression*
   interface_method_function(Interface_field_reference_expression*,
 			    Expression**, Location);
@@ -2805,7 +2860,7 @@ class Array_index_expression : public Expression
 			 Expression* end, Expression* cap, Location location)
     : Expression(EXPRESSION_ARRAY_INDEX, location),
       array_(array), start_(start), end_(end), cap_(cap), type_(NULL),
-      is_lvalue_(false)
+      is_lvalue_(false), needs_bounds_check_(true)
   { }
 
   // Return the array.
@@ -2849,6 +2904,17 @@ class Array_index_expression : public Expression
   set_is_lvalue()
   { this->is_lvalue_ = true; }
 
+  // Return whether this index expression needs a bounds check.
+  bool
+  needs_bounds_check() const
+  { return this->needs_bounds_check_; }
+
+  // Record that the index of this expression is known to be in
+  // bounds, so no runtime check is required.
+  void
+  set_needs_bounds_check(bool b)
+  { this->needs_bounds_check_ = b; }
+
  protected:
   int
   do_traverse(Traverse*);
@@ -2866,18 +2932,7 @@ class Array_index_expression : public Expression
   do_check_types(Gogo*);
 
   Expression*
-  do_copy()
-  {
-    return Expression::make_array_index(this->array_->copy(),
-					this->start_->copy(),
-					(this->end_ == NULL
-					 ? NULL
-					 : this->end_->copy()),
-					(this->cap_ == NULL
-					 ? NULL
-					 : this->cap_->copy()),
-					this->location());
-  }
+  do_copy();
 
   bool
   do_must_eval_subexpressions_in_order(int* skip) const;
@@ -2913,6 +2968,8 @@ class Array_index_expression : public Expression
   Type* type_;
   // Whether expr appears in an lvalue context.
   bool is_lvalue_;
+  // Whether the index needs a bounds check at runtime.
+  bool needs_bounds_check_;
 };
 
 // A string index.  This is used for both indexing and slicing.
@@ -2923,7 +2980,7 @@ class String_index_expression : public Expression
   String_index_expression(Expression* string, Expression* start,
 			  Expression* end, Location location)
     : Expression(EXPRESSION_STRING_INDEX, location),
-      string_(string), start_(start), end_(end)
+      string_(string), start_(start), end_(end), needs_bounds_check_(true)
   { }
 
   // Return the string being indexed.
@@ -2931,6 +2988,29 @@ class String_index_expression : public Expression
   string() const
   { return this->string_; }
 
+  // Return the index of a simple index expression, or the start index
+  // of a slice expression.
+  Expression*
+  start() const
+  { return this->start_; }
+
+  // Return the end index of a slice expression.  This is NULL for a
+  // simple index expression.
+  Expression*
+  end() const
+  { return this->end_; }
+
+  // Return whether this index expression needs a bounds check.
+  bool
+  needs_bounds_check() const
+  { return this->needs_bounds_check_; }
+
+  // Record that the index of this expression is known to be in
+  // bounds, so no runtime check is required.
+  void
+  set_needs_bounds_check(bool b)
+  { this->needs_bounds_check_ = b; }
+
  protected:
   int
   do_traverse(Traverse*);
@@ -2948,15 +3028,7 @@ class String_index_expression : public Expression
   do_check_types(Gogo*);
 
   Expression*
-  do_copy()
-  {
-    return Expression::make_string_index(this->string_->copy(),
-					 this->start_->copy(),
-					 (this->end_ == NULL
-					  ? NULL
-					  : this->end_->copy()),
-					 this->location());
-  }
+  do_copy();
 
   bool
   do_must_eval_subexpressions_in_order(int*) const
@@ -2976,6 +3048,8 @@ class String_index_expression : public Expression
   // The end index of a slice.  This may be NULL for a single index,
   // or it may be a nil expression for the length of the string.
   Expression* end_;
+  // Whether the index needs a bounds check at runtime.
+  bool needs_bounds_check_;
 };
 
 // An index into a map.
@@ -3262,7 +3336,7 @@ class Interface_field_reference_expression : public Expression
 				       const std::string& name,
 				       Location location)
     : Expression(EXPRESSION_INTERFACE_FIELD_REFERENCE, location),
-      expr_(expr), name_(name)
+      expr_(expr), name_(name), allocate_on_stack_(false)
   { }
 
   // Return the expression for the interface object.
@@ -3289,6 +3363,12 @@ class Interface_field_reference_expression : public Expression
   Expression*
   get_underlying_object();
 
+  // Note that when used as a method value the closure does not
+  // escape, so it may be allocated on the stack.
+  void
+  set_allocate_on_stack()
+  { this->allocate_on_stack_ = true; }
+
  protected:
   int
   do_traverse(Traverse* traverse);
@@ -3332,6 +3412,9 @@ class Interface_field_reference_expression : public Expression
   Expression* expr_;
   // The field we are retrieving--the name of the method.
   std::string name_;
+  // Whether the closure for a method value may be allocated on the
+  // stack.
+  bool allocate_on_stack_;
 };
 
 // Implement the builtin function new.
@@ -3694,7 +3777,8 @@ class Map_construction_expression : public Expression
   Map_construction_expression(Type* type, Expression_list* vals,
 			      Location location)
     : Expression(EXPRESSION_MAP_CONSTRUCTION, location),
-      type_(type), vals_(vals), element_type_(NULL), constructor_temp_(NULL)
+      type_(type), vals_(vals), element_type_(NULL), constructor_temp_(NULL),
+      static_constructor_(NULL)
   { go_assert(vals == NULL || vals->size() % 2 == 0); }
 
   Expression_list*
@@ -3739,6 +3823,9 @@ class Map_construction_expression : public Expression
   Struct_type* element_type_;
   // A temporary reference to the variable storing the constructor initializer.
   Temporary_statement* constructor_temp_;
+  // The constructor initializer, if it is a static initializer that
+  // can be laid out in read-only data rather than in a temporary.
+  Expression* static_constructor_;
 };
 
 // A type guard expression.
@@ -4055,7 +4142,7 @@ class Numeric_constant
 {
  public:
   Numeric_constant()
-    : classification_(NC_INVALID), type_(NULL)
+    : classification_(NC_INVALID), is_small_(false), type_(NULL)
   { }
 
   ~Numeric_constant();
@@ -4076,6 +4163,14 @@ class Numeric_constant
   void
   set_rune(Type*, const mpz_t);
 
+  // Set to an integer value that fits in a long.
+  void
+  set_long(Type*, long);
+
+  // Set to a rune value that fits in a long.
+  void
+  set_rune_long(Type*, long);
+
   // Set to a floating point value.
   void
   set_float(Type*, const mpfr_t);
@@ -4125,6 +4220,18 @@ class Numeric_constant
   void
   get_complex(mpc_t*) const;
 
+  // If the value is an integer or rune held in a long, rather than
+  // in an mpz_t, set *VAL and return true.  Constant folding uses
+  // this to avoid GMP for the common case of small values.
+  bool
+  small_int_value(long* val) const
+  {
+    if (!this->is_small_)
+      return false;
+    *val = this->u_.small_val;
+    return true;
+  }
+
   // Codes returned by to_unsigned_long.
   enum To_unsigned_long
   {
@@ -4202,6 +4309,9 @@ class Numeric_constant
   bool
   check_int_type(Integer_type*, bool, Location);
 
+  static bool
+  long_fits_int_type(long, Integer_type*);
+
   bool
   check_float_type(Float_type*, bool, Location);
 
@@ -4221,12 +4331,24 @@ class Numeric_constant
     NC_COMPLEX
   };
 
+  void
+  set_small(Classification, Type*, long);
+
+  void
+  set_mpz(Classification, Type*, const mpz_t);
+
   // The kind of constant.
   Classification classification_;
+  // If NC_INT or NC_RUNE, whether the value is in small_val rather
+  // than int_val.  Most integer constants fit in a long, and keeping
+  // them there avoids GMP allocations.
+  bool is_small_;
   // The value.
   union
   {
-    // If NC_INT or NC_RUNE.
+    // If NC_INT or NC_RUNE and is_small_.
+    long small_val;
+    // If NC_INT or NC_RUNE and !is_small_.
     mpz_t int_val;
     // If NC_FLOAT.
     mpfr_t float_val;
@@ -46,6 +46,28 @@ go_create_gogo(const struct go_create_gogo_args* args)
   ::gogo->set_nil_check_size_threshold(args->nil_check_size_threshold);
 }
 
+// Read profile data from the -fgo-profile-use option.  This must be
+// called after go_create_gogo.
+
+GO_EXTERN_C
+void
+go_read_profile(const char* filename)
+{
+  go_assert(::gogo != NULL);
+  ::gogo->read_profile(filename);
+}
+
+// Report optimizations for -fgo-debug-optimization.  This must be
+// called after go_create_gogo.
+
+GO_EXTERN_C
+void
+go_set_debug_optimization(bool debug)
+{
+  go_assert(::gogo != NULL);
+  ::gogo->set_debug_optimization(debug);
+}
+
 // Parse the input files.
 
 GO_EXTERN_C
@@ -138,11 +160,17 @@ go_parse_input_files(const char** filenames, unsigned int filename_count,
   if (only_check_syntax)
     return;
 
+  // Call interface methods directly when the dynamic type is known.
+  ::gogo->devirtualize_calls();
+
   ::gogo->analyze_escape();
 
   // Export global identifiers as appropriate.
   ::gogo->do_exports();
 
+  // Remove unexported functions that nothing refers to.
+  ::gogo->eliminate_dead_functions();
+
   // Use temporary variables to force order of evaluation.
   ::gogo->order_evaluations();
 
@@ -164,9 +192,18 @@ go_parse_input_files(const char** filenames, unsigned int filename_count,
   // Add write barriers.
   ::gogo->add_write_barriers();
 
+  // Remove bounds checks that are known to be unnecessary.
+  ::gogo->eliminate_bounds_checks();
+
+  // Remove nil checks that are known to be unnecessary.
+  ::gogo->eliminate_nil_checks();
+
   // Flatten the parse tree.
   ::gogo->flatten();
 
+  // Share the backend variables of temporaries that are no longer live.
+  ::gogo->reuse_temporaries();
+
   // Reclaim memory of escape analysis Nodes.
   ::gogo->reclaim_escape_nodes();
 
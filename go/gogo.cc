@@ -7,6 +7,7 @@
 #include "go-system.h"
 
 #include <fstream>
+#include <limits>
 
 #include "filenames.h"
 
@@ -55,11 +56,17 @@ Gogo::Gogo(Backend* backend, Linemap* linemap, int, int pointer_size)
     check_divide_overflow_(true),
     compiling_runtime_(false),
     debug_escape_level_(0),
+    debug_optimization_(false),
     nil_check_size_threshold_(4096),
+    profile_cases_(),
+    profile_calls_(),
     verify_types_(),
     interface_types_(),
     specific_type_functions_(),
     specific_type_functions_are_written_(false),
+    exported_type_descriptors_(),
+    static_itabs_(),
+    static_itab_hashes_(),
     named_types_are_converted_(false),
     analysis_sets_(),
     gc_roots_()
@@ -869,6 +876,109 @@ Gogo::register_gc_vars(const std::vector<Named_object*>& var_gc,
   init_stmts.push_back(this->backend()->expression_statement(init_bfn, bcall));
 }
 
+// Record a statically built interface method table.  Each conversion
+// site builds its own address expression, so look for an existing
+// entry by the identity of the types.
+
+void
+Gogo::record_static_itab(Type* itype, Type* type, bool is_pointer,
+			 Expression* mtable)
+{
+  unsigned int hash = (itype->hash_for_method(NULL) * 31
+		       + type->hash_for_method(NULL)) * 2 + is_pointer;
+  std::vector<size_t>& indexes(this->static_itab_hashes_[hash]);
+  for (std::vector<size_t>::const_iterator p = indexes.begin();
+       p != indexes.end();
+       ++p)
+    {
+      const Static_itab& si(this->static_itabs_[*p]);
+      if (si.is_pointer == is_pointer
+	  && Type::are_identical(si.itype, itype, false, NULL)
+	  && Type::are_identical(si.type, type, false, NULL))
+	return;
+    }
+  indexes.push_back(this->static_itabs_.size());
+  this->static_itabs_.push_back(Static_itab(itype, type, is_pointer, mtable));
+}
+
+// Register the interface method tables built by the compiler with the
+// runtime's itab cache, so that converting an interface value of one
+// of these types to one of these interfaces at run time finds the
+// table rather than building it.
+
+void
+Gogo::register_itabs(std::vector<Bstatement*>& init_stmts,
+		     Bfunction* init_bfn)
+{
+  if (this->static_itabs_.empty())
+    return;
+
+  // The runtime package initializes the cache itself.
+  if (this->compiling_runtime() && this->package_name() == "runtime")
+    return;
+
+  Location bloc = Linemap::predeclared_location();
+  Translate_context context(this, NULL, NULL, NULL);
+  context.set_is_const();
+
+  Type* pvt = Type::make_pointer_type(Type::make_void_type());
+  Btype* bpvt = pvt->get_backend(this);
+  std::vector<Backend::Btyped_identifier> fields;
+  fields.push_back(Backend::Btyped_identifier("inter", bpvt, bloc));
+  fields.push_back(Backend::Btyped_identifier("itab", bpvt, bloc));
+  Btype* entry_btype = this->backend()->struct_type(fields);
+
+  size_t count = this->static_itabs_.size();
+  std::vector<unsigned long> indexes;
+  std::vector<Bexpression*> vals;
+  indexes.reserve(count);
+  vals.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    {
+      Type* itype = this->static_itabs_[i].itype;
+      Expression* mtable = this->static_itabs_[i].mtable;
+
+      std::vector<Bexpression*> entry;
+      Expression* td = Expression::make_type_descriptor(itype, bloc);
+      entry.push_back(this->backend()->convert_expression(bpvt,
+							  td->get_backend(&context),
+							  bloc));
+      entry.push_back(this->backend()->convert_expression(bpvt,
+							  mtable->get_backend(&context),
+							  bloc));
+      indexes.push_back(i);
+      vals.push_back(this->backend()->constructor_expression(entry_btype,
+							     entry, bloc));
+    }
+
+  Type* int_type = Type::lookup_integer_type("int");
+  Expression* length = Expression::make_integer_ul(count, int_type, bloc);
+  Btype* array_btype =
+    this->backend()->array_type(entry_btype, length->get_backend(&context));
+  Bexpression* array_init =
+    this->backend()->array_constructor_expression(array_btype, indexes, vals,
+						  bloc);
+
+  std::string var_name(this->initializer_name());
+  std::string asm_name(go_selectively_encode_id(var_name));
+  Bvariable* bvar = this->backend()->immutable_struct(var_name, asm_name,
+						      true, false,
+						      array_btype, bloc);
+  this->backend()->immutable_struct_set_init(bvar, var_name, true, false,
+					     array_btype, bloc, array_init);
+
+  Bexpression* baddr =
+    this->backend()->address_expression(this->backend()->var_expression(bvar,
+									 bloc),
+					bloc);
+  baddr = this->backend()->convert_expression(bpvt, baddr, bloc);
+  Expression* addr = Expression::make_backend(baddr, pvt, bloc);
+  Expression* call = Runtime::make_call(Runtime::REGISTER_ITABS, bloc, 2,
+					addr, length);
+  Bexpression* bcall = call->get_backend(&context);
+  init_stmts.push_back(this->backend()->expression_statement(init_bfn, bcall));
+}
+
 // Build the decl for the initialization function.
 
 Named_object*
@@ -1346,6 +1456,13 @@ Gogo::write_globals()
 {
   this->build_interface_method_tables();
 
+  // Define the type descriptors promised in the export data.
+  for (std::vector<Type*>::const_iterator p =
+	 this->exported_type_descriptors_.begin();
+       p != this->exported_type_descriptors_.end();
+       ++p)
+    (*p)->type_descriptor_pointer(this, Linemap::predeclared_location());
+
   Bindings* bindings = this->current_bindings();
 
   for (Bindings::const_declarations_iterator p = bindings->begin_declarations();
@@ -1546,6 +1663,12 @@ Gogo::write_globals()
   // Register global variables with the garbage collector.
   this->register_gc_vars(var_gc, init_stmts, init_bfn);
 
+  // Register interface method tables with the runtime.  This is only
+  // an optimization, so don't create an initialization function just
+  // for this.
+  if (this->need_init_fn_ || this->is_main_package())
+    this->register_itabs(init_stmts, init_bfn);
+
   // Simple variable initializations, after all variables are
   // registered.
   init_stmts.push_back(this->backend()->statement_list(var_init_stmts));
@@ -2569,6 +2692,14 @@ Gogo::write_specific_type_functions()
   Specific_type_functions stf(this);
   this->traverse(&stf);
 
+  // We promised importers to define the functions for the unnamed
+  // types in the export data.
+  for (std::vector<Type*>::const_iterator p =
+	 this->exported_type_descriptors_.begin();
+       p != this->exported_type_descriptors_.end();
+       ++p)
+    Type::traverse(*p, &stf);
+
   while (!this->specific_type_functions_.empty())
     {
       Specific_type_function* tsf = this->specific_type_functions_.back();
@@ -3432,325 +3563,640 @@ Gogo::check_types_in_block(Block* block)
   block->traverse(&traverse);
 }
 
-// A traversal class which finds all the expressions which must be
-// evaluated in order within a statement or larger expression.  This
-// is used to implement the rules about order of evaluation.
+// Profile data.  The -fgo-profile-use=FILE option names a text file,
+// normally produced from a pprof profile, with one record per line:
+//
+//   case FILE:LINE COUNT
+//     The switch or type switch case at FILE:LINE was chosen COUNT
+//     times.
+//   call FILE:LINE TYPE COUNT
+//     The interface method call at FILE:LINE was made COUNT times
+//     with dynamic type TYPE, written as NAME or *NAME for a type
+//     defined at package level in the package being compiled.
+//
+// Blank lines and lines starting with '#' are ignored.  Only the base
+// name of FILE is used.
 
-class Find_eval_ordering : public Traverse
+// Return the key used to look up profile data for FILE:LINE.
+
+static std::string
+profile_key(const std::string& loc)
 {
- private:
-  typedef std::vector<Expression**> Expression_pointers;
+  size_t slash = loc.rfind('/');
+  if (slash == std::string::npos)
+    return loc;
+  return loc.substr(slash + 1);
+}
 
- public:
-  Find_eval_ordering()
-    : Traverse(traverse_blocks
-	       | traverse_statements
-	       | traverse_expressions),
-      exprs_()
-  { }
+// Read the profile data.
 
-  size_t
-  size() const
-  { return this->exprs_.size(); }
+bool
+Gogo::read_profile(const char* filename)
+{
+  std::ifstream in(filename);
+  if (!in)
+    {
+      go_error_at(Linemap::unknown_location(),
+		  "cannot open profile %s: %m", filename);
+      return false;
+    }
 
-  typedef Expression_pointers::const_iterator const_iterator;
+  // The count for the hot type at each call site.
+  Unordered_map(std::string, uint64_t) call_counts;
 
-  const_iterator
-  begin() const
-  { return this->exprs_.begin(); }
+  std::string line;
+  int lineno = 0;
+  while (std::getline(in, line))
+    {
+      ++lineno;
+      if (line.empty() || line[0] == '#')
+	continue;
 
-  const_iterator
-  end() const
-  { return this->exprs_.end(); }
+      std::istringstream fields(line);
+      std::string kind;
+      std::string loc;
+      std::string type;
+      uint64_t count;
+      fields >> kind >> loc;
+      bool ok;
+      if (kind == "case")
+	ok = static_cast<bool>(fields >> count);
+      else if (kind == "call")
+	ok = static_cast<bool>(fields >> type >> count);
+      else
+	ok = false;
+      if (!ok || loc.empty())
+	{
+	  go_error_at(Linemap::unknown_location(),
+		      "%s:%d: malformed profile record", filename, lineno);
+	  continue;
+	}
 
- protected:
-  int
-  block(Block*)
-  { return TRAVERSE_SKIP_COMPONENTS; }
+      std::string key = profile_key(loc);
+      if (kind == "case")
+	this->profile_cases_[key] += count;
+      else if (count > call_counts[key])
+	{
+	  call_counts[key] = count;
+	  this->profile_calls_[key] = type;
+	}
+    }
+
+  return true;
+}
+
+// Return the profile count for a switch case.
+
+uint64_t
+Gogo::profile_case_count(Location loc) const
+{
+  if (this->profile_cases_.empty())
+    return 0;
+  std::string key = profile_key(Linemap::location_to_string(loc));
+  Unordered_map(std::string, uint64_t)::const_iterator p =
+    this->profile_cases_.find(key);
+  if (p == this->profile_cases_.end())
+    return 0;
+  return p->second;
+}
+
+// Return the hot type name for an interface method call.
+
+const std::string*
+Gogo::profile_call_type(Location loc) const
+{
+  if (this->profile_calls_.empty())
+    return NULL;
+  std::string key = profile_key(Linemap::location_to_string(loc));
+  Unordered_map(std::string, std::string)::const_iterator p =
+    this->profile_calls_.find(key);
+  if (p == this->profile_calls_.end())
+    return NULL;
+  return &p->second;
+}
+
+// Devirtualization.  A local variable of interface type that is set
+// only by its declaration, from a value of non-interface type, always
+// holds a value of that type.  A method call through such a variable
+// can call the method directly, which lets escape analysis see the
+// callee.  We keep the concrete value in a temporary, convert the
+// temporary to the interface for the variable's initializer, and bind
+// the calls to the temporary.
+
+// The -fgo-optimize-devirtualize flag enables this pass.
+
+Go_optimize optimize_devirtualize_flag("devirtualize", true);
+
+// Find local interface variables that are initialized from a value of
+// non-interface type, local variables that may be changed after they
+// are declared, and calls to methods of interface variables.
+
+class Find_devirtualize : public Traverse
+{
+ public:
+  // The block and declaration of a candidate variable.
+  typedef std::pair<Block*, Variable_declaration_statement*> Decl;
+  typedef Unordered_map(Named_object*, Decl) Candidates;
+  typedef Unordered_set(Named_object*) Vars;
+  typedef std::vector<std::pair<Call_expression*, Named_object*> > Calls;
+
+  Find_devirtualize()
+    : Traverse(traverse_statements | traverse_expressions),
+      candidates_(), changed_(), calls_()
+  { }
 
   int
-  statement(Block*, size_t*, Statement*)
-  { return TRAVERSE_SKIP_COMPONENTS; }
+  statement(Block*, size_t*, Statement*);
 
   int
   expression(Expression**);
 
+  // Return the declaration of the variable if it can be devirtualized,
+  // or NULL.
+  Variable_declaration_statement*
+  declaration(Named_object* no, Block** pblock) const;
+
+  const Calls&
+  calls() const
+  { return this->calls_; }
+
  private:
-  // A list of pointers to expressions with side-effects.
-  Expression_pointers exprs_;
+  Candidates candidates_;
+  Vars changed_;
+  Calls calls_;
 };
 
-// If an expression must be evaluated in order, put it on the list.
+int
+Find_devirtualize::statement(Block* block, size_t*, Statement* s)
+{
+  Variable_declaration_statement* vds = s->variable_declaration_statement();
+  if (vds != NULL)
+    {
+      Variable* var = vds->var()->var_value();
+      Expression* init = var->init();
+      if (!var->is_global()
+	  && init != NULL
+	  && !var->has_pre_init()
+	  && var->type()->interface_type() != NULL)
+	{
+	  Type* type = init->type();
+	  if (type->interface_type() == NULL
+	      && !type->is_nil_type()
+	      && !type->is_abstract()
+	      && !type->is_error())
+	    this->candidates_[vds->var()] = std::make_pair(block, vds);
+	}
+      return TRAVERSE_CONTINUE;
+    }
+
+  Assignment_statement* as = s->assignment_statement();
+  if (as != NULL)
+    {
+      Var_expression* ve = as->lhs()->var_expression();
+      Enclosed_var_expression* eve = as->lhs()->enclosed_var_expression();
+      if (ve != NULL)
+	this->changed_.insert(ve->named_object());
+      else if (eve != NULL)
+	this->changed_.insert(eve->variable());
+    }
+
+  return TRAVERSE_CONTINUE;
+}
 
 int
-Find_eval_ordering::expression(Expression** expression_pointer)
+Find_devirtualize::expression(Expression** pexpr)
 {
-  Binary_expression* binexp = (*expression_pointer)->binary_expression();
-  if (binexp != NULL
-      && (binexp->op() == OPERATOR_ANDAND || binexp->op() == OPERATOR_OROR))
+  Expression* expr = *pexpr;
+
+  // A variable referenced by a closure, or whose address is taken,
+  // may be changed anywhere.
+  Enclosed_var_expression* eve = expr->enclosed_var_expression();
+  if (eve != NULL)
     {
-      // Shortcut expressions may potentially have side effects which need
-      // to be ordered, so add them to the list.
-      // We don't order its subexpressions here since they may be evaluated
-      // conditionally. This is handled in remove_shortcuts.
-      this->exprs_.push_back(expression_pointer);
-      return TRAVERSE_SKIP_COMPONENTS;
+      this->changed_.insert(eve->variable());
+      return TRAVERSE_CONTINUE;
+    }
+  Unary_expression* ue = expr->unary_expression();
+  if (ue != NULL && ue->op() == OPERATOR_AND)
+    {
+      Var_expression* ve = ue->operand()->var_expression();
+      if (ve != NULL)
+	this->changed_.insert(ve->named_object());
+      return TRAVERSE_CONTINUE;
     }
 
-  // We have to look at subexpressions before this one.
-  if ((*expression_pointer)->traverse_subexpressions(this) == TRAVERSE_EXIT)
-    return TRAVERSE_EXIT;
-  if ((*expression_pointer)->must_eval_in_order())
-    this->exprs_.push_back(expression_pointer);
-  return TRAVERSE_SKIP_COMPONENTS;
+  Call_expression* call = expr->call_expression();
+  if (call == NULL)
+    return TRAVERSE_CONTINUE;
+  Interface_field_reference_expression* ifre =
+    call->fn()->interface_field_reference_expression();
+  if (ifre == NULL)
+    return TRAVERSE_CONTINUE;
+  Var_expression* ve = ifre->expr()->var_expression();
+  if (ve != NULL && ve->named_object()->is_variable())
+    this->calls_.push_back(std::make_pair(call, ve->named_object()));
+  return TRAVERSE_CONTINUE;
 }
 
-// A traversal class for ordering evaluations.
+Variable_declaration_statement*
+Find_devirtualize::declaration(Named_object* no, Block** pblock) const
+{
+  if (this->changed_.find(no) != this->changed_.end())
+    return NULL;
+  Candidates::const_iterator p = this->candidates_.find(no);
+  if (p == this->candidates_.end())
+    return NULL;
+  *pblock = p->second.first;
+  return p->second.second;
+}
 
-class Order_eval : public Traverse
+// Profile guided devirtualization.  When the profile says that an
+// interface method call is nearly always made with the same dynamic
+// type, test for that type and call its method directly, falling
+// back to the interface call.  We only do this for calls that are
+// statements or that are assigned to a variable, since we need to
+// put the call in both arms of an if statement.
+
+class Guarded_devirtualize : public Traverse
 {
  public:
-  Order_eval(Gogo* gogo)
-    : Traverse(traverse_variables
-	       | traverse_statements),
+  Guarded_devirtualize(Gogo* gogo)
+    : Traverse(traverse_statements),
       gogo_(gogo)
   { }
 
   int
-  variable(Named_object*);
-
-  int
-  statement(Block*, size_t*, Statement*);
+  statement(Block*, size_t* pindex, Statement*);
 
  private:
-  // The IR.
+  Type*
+  lookup_type(const std::string&);
+
+  // General IR.
   Gogo* gogo_;
 };
 
-// Implement the order of evaluation rules for a statement.
+// Look up a type named in the profile.
 
-int
-Order_eval::statement(Block* block, size_t* pindex, Statement* stmt)
+Type*
+Guarded_devirtualize::lookup_type(const std::string& name)
 {
-  // FIXME: This approach doesn't work for switch statements, because
-  // we add the new statements before the whole switch when we need to
-  // instead add them just before the switch expression.  The right
-  // fix is probably to lower switch statements with nonconstant cases
-  // to a series of conditionals.
-  if (stmt->switch_statement() != NULL)
+  bool is_pointer = !name.empty() && name[0] == '*';
+  std::string n = is_pointer ? name.substr(1) : name;
+  if (n.empty())
+    return NULL;
+  n = this->gogo_->pack_hidden_name(n, Lex::is_exported_name(n));
+  Named_object* no = this->gogo_->lookup(n, NULL);
+  if (no == NULL || !no->is_type())
+    return NULL;
+  Type* type = no->type_value();
+  if (is_pointer)
+    type = Type::make_pointer_type(type);
+  return type;
+}
+
+int
+Guarded_devirtualize::statement(Block* block, size_t* pindex, Statement* s)
+{
+  Expression_statement* es = s->expression_statement();
+  Assignment_statement* as = s->assignment_statement();
+  Expression* expr;
+  if (es != NULL)
+    expr = es->expr();
+  else if (as != NULL
+	   && (as->lhs()->var_expression() != NULL
+	       || as->lhs()->temporary_reference_expression() != NULL))
+    expr = as->rhs();
+  else
     return TRAVERSE_CONTINUE;
 
-  Find_eval_ordering find_eval_ordering;
+  Call_expression* call = expr->call_expression();
+  if (call == NULL || call->result_count() > 1)
+    return TRAVERSE_CONTINUE;
+  Interface_field_reference_expression* ifre =
+    call->fn()->interface_field_reference_expression();
+  if (ifre == NULL)
+    return TRAVERSE_CONTINUE;
 
-  // If S is a variable declaration, then ordinary traversal won't do
-  // anything.  We want to explicitly traverse the initialization
-  // expression if there is one.
-  Variable_declaration_statement* vds = stmt->variable_declaration_statement();
-  Expression* init = NULL;
-  Expression* orig_init = NULL;
-  if (vds == NULL)
-    stmt->traverse_contents(&find_eval_ordering);
-  else
-    {
-      init = vds->var()->var_value()->init();
-      if (init == NULL)
-	return TRAVERSE_CONTINUE;
-      orig_init = init;
+  Location loc = call->location();
+  const std::string* type_name = this->gogo_->profile_call_type(loc);
+  if (type_name == NULL)
+    return TRAVERSE_CONTINUE;
+  Type* type = this->lookup_type(*type_name);
+  Interface_type* itype = ifre->expr()->type()->interface_type();
+  if (type == NULL
+      || itype == NULL
+      || !itype->implements_interface(type, NULL))
+    return TRAVERSE_CONTINUE;
 
-      // It might seem that this could be
-      // init->traverse_subexpressions.  Unfortunately that can fail
-      // in a case like
-      //   var err os.Error
-      //   newvar, err := call(arg())
-      // Here newvar will have an init of call result 0 of
-      // call(arg()).  If we only traverse subexpressions, we will
-      // only find arg(), and we won't bother to move anything out.
-      // Then we get to the assignment to err, we will traverse the
-      // whole statement, and this time we will find both call() and
-      // arg(), and so we will move them out.  This will cause them to
-      // be put into temporary variables before the assignment to err
-      // but after the declaration of newvar.  To avoid that problem,
-      // we traverse the entire expression here.
-      Expression::traverse(&init, &find_eval_ordering);
-    }
+  // Evaluate the interface value once.
+  Temporary_statement* recv = Statement::make_temporary(NULL, ifre->expr(),
+							loc);
 
-  size_t c = find_eval_ordering.size();
-  if (c == 0)
+  // if ifacetypeeq(TYPE, ifacetype(RECV)) { RECV.(TYPE).M(ARGS) }
+  Call_expression* direct = call->copy()->call_expression();
+  Expression* ref = Expression::make_temporary_reference(recv, loc);
+  if (!direct->devirtualize(this->gogo_, type,
+			    Expression::make_type_guard(ref, type, loc)))
     return TRAVERSE_CONTINUE;
 
-  // If there is only one expression with a side-effect, we can
-  // usually leave it in place.
-  if (c == 1)
+  // else { RECV.M(ARGS) }
+  ref = Expression::make_temporary_reference(recv, loc);
+  Expression* fn =
+    Expression::make_interface_field_reference(ref, ifre->name(),
+					       ifre->location());
+  Call_expression* indirect = Expression::make_call(fn, call->args(),
+						    call->is_varargs(), loc);
+  if (call->varargs_are_lowered())
+    indirect->set_varargs_are_lowered();
+
+  Block* then_block = new Block(block, loc);
+  Block* else_block = new Block(block, loc);
+  if (es != NULL)
     {
-      switch (stmt->classification())
-	{
-	case Statement::STATEMENT_ASSIGNMENT:
-	  // For an assignment statement, we need to evaluate an
-	  // expression on the right hand side before we evaluate any
-	  // index expression on the left hand side, so for that case
-	  // we always move the expression.  Otherwise we mishandle
-	  // m[0] = len(m) where m is a map.
-	  break;
+      then_block->add_statement(Statement::make_statement(direct, false));
+      else_block->add_statement(Statement::make_statement(indirect, false));
+    }
+  else
+    {
+      then_block->add_statement(Statement::make_assignment(as->lhs()->copy(),
+							   direct, loc));
+      else_block->add_statement(Statement::make_assignment(as->lhs(),
+							   indirect, loc));
+    }
+
+  ref = Expression::make_temporary_reference(recv, loc);
+  Runtime::Function code = (itype->is_empty()
+			    ? Runtime::EFACETYPE
+			    : Runtime::IFACETYPE);
+  Expression* descriptor = Runtime::make_call(code, loc, 1, ref);
+  Expression* cond =
+    Runtime::make_call(Runtime::IFACETYPEEQ, loc, 2,
+		       Expression::make_type_descriptor(type, loc),
+		       descriptor);
+  Statement* ifs = Statement::make_if_statement(cond, then_block, else_block,
+						loc);
+
+  block->insert_statement_before(*pindex, recv);
+  ++*pindex;
+  block->replace_statement(*pindex, ifs);
+
+  if (this->gogo_->debug_optimization())
+    go_inform(loc, "call to method %qs devirtualized for type %qs",
+	      Gogo::message_name(ifre->name()).c_str(),
+	      type_name->c_str());
 
-	case Statement::STATEMENT_EXPRESSION:
-	  {
-	    // If this is a call statement that doesn't return any
-	    // values, it will not have been counted as a value to
-	    // move.  We need to move any subexpressions in case they
-	    // are themselves call statements that require passing a
-	    // closure.
-	    Expression* expr = stmt->expression_statement()->expr();
-	    if (expr->call_expression() != NULL
-		&& expr->call_expression()->result_count() == 0)
-	      break;
-	    return TRAVERSE_CONTINUE;
-	  }
+  return TRAVERSE_SKIP_COMPONENTS;
+}
 
-	default:
-	  // We can leave the expression in place.
-	  return TRAVERSE_CONTINUE;
-	}
-    }
+// Call methods directly when the dynamic type of an interface
+// variable is known.
 
-  bool is_thunk = stmt->thunk_statement() != NULL;
-  Expression_statement* es = stmt->expression_statement();
-  for (Find_eval_ordering::const_iterator p = find_eval_ordering.begin();
-       p != find_eval_ordering.end();
+void
+Gogo::devirtualize_calls()
+{
+  if (!optimize_devirtualize_flag.is_enabled())
+    return;
+
+  Find_devirtualize fd;
+  this->traverse(&fd);
+
+  // The temporary holding the concrete value of each variable.
+  Unordered_map(Named_object*, Temporary_statement*) temps;
+  const Find_devirtualize::Calls& calls(fd.calls());
+  for (Find_devirtualize::Calls::const_iterator p = calls.begin();
+       p != calls.end();
        ++p)
     {
-      Expression** pexpr = *p;
-
-      // The last expression in a thunk will be the call passed to go
-      // or defer, which we must not evaluate early.
-      if (is_thunk && p + 1 == find_eval_ordering.end())
-	break;
+      Call_expression* call = p->first;
+      Named_object* no = p->second;
+      if (call->fn()->interface_field_reference_expression() == NULL)
+	continue;
+      Block* block;
+      Variable_declaration_statement* vds = fd.declaration(no, &block);
+      if (vds == NULL)
+	continue;
 
-      Location loc = (*pexpr)->location();
-      Statement* s;
-      if ((*pexpr)->call_expression() == NULL
-	  || (*pexpr)->call_expression()->result_count() < 2)
-	{
-	  Temporary_statement* ts = Statement::make_temporary(NULL, *pexpr,
-							      loc);
-	  s = ts;
-	  *pexpr = Expression::make_temporary_reference(ts, loc);
-	}
+      Temporary_statement* ts;
+      Unordered_map(Named_object*, Temporary_statement*)::const_iterator pt =
+	temps.find(no);
+      if (pt != temps.end())
+	ts = pt->second;
       else
 	{
-	  // A call expression which returns multiple results needs to
-	  // be handled specially.  We can't create a temporary
-	  // because there is no type to give it.  Any actual uses of
-	  // the values will be done via Call_result_expressions.
-          //
-          // Since a given call expression can be shared by multiple
-          // Call_result_expressions, avoid hoisting the call the
-          // second time we see it here. In addition, don't try to
-          // hoist the top-level multi-return call in the statement,
-          // since doing this would result a tree with more than one copy
-          // of the call.
-          if (this->remember_expression(*pexpr))
-            s = NULL;
-          else if (es != NULL && *pexpr == es->expr())
-            s = NULL;
-          else
-            s = Statement::make_statement(*pexpr, true);
-        }
+	  // Move the initializer into a temporary declared just
+	  // before the variable.
+	  Variable* var = no->var_value();
+	  Location loc = var->init()->location();
+	  ts = Statement::make_temporary(NULL, var->init(), loc);
+	  const std::vector<Statement*>* stmts = block->statements();
+	  size_t i;
+	  for (i = 0; i < stmts->size(); ++i)
+	    if ((*stmts)[i] == vds)
+	      break;
+	  go_assert(i < stmts->size());
+	  block->insert_statement_before(i, ts);
+	  var->set_init(Expression::make_temporary_reference(ts, loc));
+	  temps[no] = ts;
+	}
 
-      if (s != NULL)
-        {
-          block->insert_statement_before(*pindex, s);
-          ++*pindex;
-        }
+      Location loc = call->location();
+      std::string name =
+	call->fn()->interface_field_reference_expression()->name();
+      Expression* ref = Expression::make_temporary_reference(ts, loc);
+      if (call->devirtualize(this, ts->type(), ref)
+	  && this->debug_optimization())
+	go_inform(loc, "devirtualized call to method %qs",
+		  Gogo::message_name(name).c_str());
     }
 
-  if (init != orig_init)
-    vds->var()->var_value()->set_init(init);
+  if (this->has_profile())
+    {
+      Guarded_devirtualize gd(this);
+      this->traverse(&gd);
+    }
+}
+
+// Dead function elimination.  An unexported function that is not a
+// method and has no assembler name is not visible outside of this
+// package, so if nothing in the package refers to it we need not
+// convert it to the backend.  The same is true of function literals.
+// We walk from everything that may be referenced from elsewhere:
+// exported functions, init functions, main, functions named by
+// go:linkname, methods (which may appear in type descriptors), and
+// the initializers of global variables.
+
+// The -fgo-optimize-deadcode flag enables this pass.
+
+Go_optimize optimize_deadcode_flag("deadcode", true);
+
+// Find the functions referenced by reachable code.
+
+class Find_reachable_functions : public Traverse
+{
+ public:
+  Find_reachable_functions(Gogo* gogo)
+    : Traverse(traverse_functions | traverse_expressions),
+      gogo_(gogo), reached_(), queue_()
+  { }
+
+  // Whether NO is a function that we may be able to remove.
+  bool
+  is_candidate(Named_object* no) const;
+
+  // Whether the candidate function NO was found to be reachable.
+  bool
+  is_reached(Named_object* no) const
+  { return this->reached_.find(no) != this->reached_.end(); }
+
+  // Traverse the bodies of newly reached functions until no more are
+  // found.
+  void
+  drain();
+
+  int
+  function(Named_object*);
+
+  int
+  expression(Expression**);
+
+ private:
+  Gogo* gogo_;
+  // The candidate functions that are reachable.
+  Unordered_set(Named_object*) reached_;
+  // Reached functions whose bodies have not been traversed.
+  std::vector<Named_object*> queue_;
+};
+
+bool
+Find_reachable_functions::is_candidate(Named_object* no) const
+{
+  if (!no->is_function() || no->package() != NULL)
+    return false;
+  Function* func = no->func_value();
+  if (func->is_sink()
+      || func->type()->is_method()
+      || !func->asm_name().empty()
+      || func->block() == NULL)
+    return false;
+  if (func->enclosing() != NULL)
+    return true;
+  if (!Gogo::is_hidden_name(no->name()))
+    return false;
+  std::string name = Gogo::unpack_hidden_name(no->name());
+  if (name == "main" && this->gogo_->is_main_package())
+    return false;
+  return !Gogo::is_erroneous_name(no->name());
+}
 
+// Don't look inside candidate functions until we know they are
+// reachable.
+
+int
+Find_reachable_functions::function(Named_object* no)
+{
+  if (this->is_candidate(no))
+    return TRAVERSE_SKIP_COMPONENTS;
   return TRAVERSE_CONTINUE;
 }
 
-// Implement the order of evaluation rules for the initializer of a
-// global variable.
+// Record references to candidate functions.
 
 int
-Order_eval::variable(Named_object* no)
+Find_reachable_functions::expression(Expression** pexpr)
 {
-  if (no->is_result_variable())
-    return TRAVERSE_CONTINUE;
-  Variable* var = no->var_value();
-  Expression* init = var->init();
-  if (!var->is_global() || init == NULL)
+  Func_expression* fe = (*pexpr)->func_expression();
+  if (fe == NULL)
     return TRAVERSE_CONTINUE;
+  Named_object* no = fe->named_object();
+  if (this->is_candidate(no) && this->reached_.insert(no).second)
+    this->queue_.push_back(no);
+  return TRAVERSE_CONTINUE;
+}
 
-  Find_eval_ordering find_eval_ordering;
-  Expression::traverse(&init, &find_eval_ordering);
-
-  if (find_eval_ordering.size() <= 1)
+void
+Find_reachable_functions::drain()
+{
+  while (!this->queue_.empty())
     {
-      // If there is only one expression with a side-effect, we can
-      // leave it in place.
-      return TRAVERSE_SKIP_COMPONENTS;
+      Named_object* no = this->queue_.back();
+      this->queue_.pop_back();
+      no->func_value()->traverse(this);
     }
+}
 
-  Expression* orig_init = init;
+// Remove functions that can not be called.
 
-  for (Find_eval_ordering::const_iterator p = find_eval_ordering.begin();
-       p != find_eval_ordering.end();
+void
+Gogo::eliminate_dead_functions()
+{
+  if (!optimize_deadcode_flag.is_enabled())
+    return;
+
+  // The runtime package is called by name from C code and from the
+  // code generated by the compiler.
+  if (this->compiling_runtime())
+    return;
+
+  Find_reachable_functions frf(this);
+  this->traverse(&frf);
+  frf.drain();
+
+  Bindings* bindings = this->package_->bindings();
+  std::vector<Named_object*> dead;
+  for (Bindings::const_definitions_iterator p = bindings->begin_definitions();
+       p != bindings->end_definitions();
        ++p)
     {
-      Expression** pexpr = *p;
-      Location loc = (*pexpr)->location();
-      Statement* s;
-      if ((*pexpr)->call_expression() == NULL
-	  || (*pexpr)->call_expression()->result_count() < 2)
-	{
-	  Temporary_statement* ts = Statement::make_temporary(NULL, *pexpr,
-							      loc);
-	  s = ts;
-	  *pexpr = Expression::make_temporary_reference(ts, loc);
-	}
-      else
-	{
-	  // A call expression which returns multiple results needs to
-	  // be handled specially.
-	  s = Statement::make_statement(*pexpr, true);
-	}
-      var->add_preinit_statement(this->gogo_, s);
+      Named_object* no = *p;
+      if (frf.is_candidate(no) && !frf.is_reached(no))
+	dead.push_back(no);
     }
+  if (dead.empty())
+    return;
 
-  if (init != orig_init)
-    var->set_init(init);
+  if (this->debug_optimization())
+    {
+      for (std::vector<Named_object*>::const_iterator p = dead.begin();
+	   p != dead.end();
+	   ++p)
+	go_inform((*p)->location(), "removing unreachable function %qs",
+		  (*p)->message_name().c_str());
+    }
 
-  return TRAVERSE_SKIP_COMPONENTS;
+  bindings->remove_bindings(dead);
 }
 
-// Use temporary variables to implement the order of evaluation rules.
+// A traversal class which finds all the expressions which must be
+// evaluated in order within a statement or larger expression.  This
+// is used to implement the rules about order of evaluation.
 
-void
-Gogo::order_evaluations()
+class Find_eval_ordering : public Traverse
 {
-  Order_eval order_eval(this);
-  this->traverse(&order_eval);
-}
-
-// A traversal class used to find a single shortcut operator within an
-// expression.
+ private:
+  typedef std::vector<Expression**> Expression_pointers;
 
-class Find_shortcut : public Traverse
-{
  public:
-  Find_shortcut()
+  Find_eval_ordering()
     : Traverse(traverse_blocks
 	       | traverse_statements
 	       | traverse_expressions),
-      found_(NULL)
+      exprs_()
   { }
 
-  // A pointer to the expression which was found, or NULL if none was
-  // found.
-  Expression**
-  found() const
-  { return this->found_; }
+  size_t
+  size() const
+  { return this->exprs_.size(); }
+
+  typedef Expression_pointers::const_iterator const_iterator;
+
+  const_iterator
+  begin() const
+  { return this->exprs_.begin(); }
+
+  const_iterator
+  end() const
+  { return this->exprs_.end(); }
 
  protected:
   int
@@ -3765,39 +4211,46 @@ class Find_shortcut : public Traverse
   expression(Expression**);
 
  private:
-  Expression** found_;
+  // A list of pointers to expressions with side-effects.
+  Expression_pointers exprs_;
 };
 
-// Find a shortcut expression.
+// If an expression must be evaluated in order, put it on the list.
 
 int
-Find_shortcut::expression(Expression** pexpr)
+Find_eval_ordering::expression(Expression** expression_pointer)
 {
-  Expression* expr = *pexpr;
-  Binary_expression* be = expr->binary_expression();
-  if (be == NULL)
-    return TRAVERSE_CONTINUE;
-  Operator op = be->op();
-  if (op != OPERATOR_OROR && op != OPERATOR_ANDAND)
-    return TRAVERSE_CONTINUE;
-  go_assert(this->found_ == NULL);
-  this->found_ = pexpr;
-  return TRAVERSE_EXIT;
+  Binary_expression* binexp = (*expression_pointer)->binary_expression();
+  if (binexp != NULL
+      && (binexp->op() == OPERATOR_ANDAND || binexp->op() == OPERATOR_OROR))
+    {
+      // Shortcut expressions may potentially have side effects which need
+      // to be ordered, so add them to the list.
+      // We don't order its subexpressions here since they may be evaluated
+      // conditionally. This is handled in remove_shortcuts.
+      this->exprs_.push_back(expression_pointer);
+      return TRAVERSE_SKIP_COMPONENTS;
+    }
+
+  // We have to look at subexpressions before this one.
+  if ((*expression_pointer)->traverse_subexpressions(this) == TRAVERSE_EXIT)
+    return TRAVERSE_EXIT;
+  if ((*expression_pointer)->must_eval_in_order())
+    this->exprs_.push_back(expression_pointer);
+  return TRAVERSE_SKIP_COMPONENTS;
 }
 
-// A traversal class used to turn shortcut operators into explicit if
-// statements.
+// A traversal class for ordering evaluations.
 
-class Shortcuts : public Traverse
+class Order_eval : public Traverse
 {
  public:
-  Shortcuts(Gogo* gogo)
+  Order_eval(Gogo* gogo)
     : Traverse(traverse_variables
 	       | traverse_statements),
       gogo_(gogo)
   { }
 
- protected:
   int
   variable(Named_object*);
 
@@ -3805,141 +4258,2064 @@ class Shortcuts : public Traverse
   statement(Block*, size_t*, Statement*);
 
  private:
-  // Convert a shortcut operator.
-  Statement*
-  convert_shortcut(Block* enclosing, Expression** pshortcut);
-
   // The IR.
   Gogo* gogo_;
 };
 
-// Remove shortcut operators in a single statement.
+// Implement the order of evaluation rules for a statement.
 
 int
-Shortcuts::statement(Block* block, size_t* pindex, Statement* s)
+Order_eval::statement(Block* block, size_t* pindex, Statement* stmt)
 {
   // FIXME: This approach doesn't work for switch statements, because
   // we add the new statements before the whole switch when we need to
   // instead add them just before the switch expression.  The right
   // fix is probably to lower switch statements with nonconstant cases
   // to a series of conditionals.
-  if (s->switch_statement() != NULL)
+  if (stmt->switch_statement() != NULL)
     return TRAVERSE_CONTINUE;
 
-  while (true)
-    {
-      Find_shortcut find_shortcut;
+  Find_eval_ordering find_eval_ordering;
 
-      // If S is a variable declaration, then ordinary traversal won't
-      // do anything.  We want to explicitly traverse the
-      // initialization expression if there is one.
-      Variable_declaration_statement* vds = s->variable_declaration_statement();
-      Expression* init = NULL;
-      if (vds == NULL)
+  // If S is a variable declaration, then ordinary traversal won't do
+  // anything.  We want to explicitly traverse the initialization
+  // expression if there is one.
+  Variable_declaration_statement* vds = stmt->variable_declaration_statement();
+  Expression* init = NULL;
+  Expression* orig_init = NULL;
+  if (vds == NULL)
+    stmt->traverse_contents(&find_eval_ordering);
+  else
+    {
+      init = vds->var()->var_value()->init();
+      if (init == NULL)
+	return TRAVERSE_CONTINUE;
+      orig_init = init;
+
+      // It might seem that this could be
+      // init->traverse_subexpressions.  Unfortunately that can fail
+      // in a case like
+      //   var err os.Error
+      //   newvar, err := call(arg())
+      // Here newvar will have an init of call result 0 of
+      // call(arg()).  If we only traverse subexpressions, we will
+      // only find arg(), and we won't bother to move anything out.
+      // Then we get to the assignment to err, we will traverse the
+      // whole statement, and this time we will find both call() and
+      // arg(), and so we will move them out.  This will cause them to
+      // be put into temporary variables before the assignment to err
+      // but after the declaration of newvar.  To avoid that problem,
+      // we traverse the entire expression here.
+      Expression::traverse(&init, &find_eval_ordering);
+    }
+
+  size_t c = find_eval_ordering.size();
+  if (c == 0)
+    return TRAVERSE_CONTINUE;
+
+  // If there is only one expression with a side-effect, we can
+  // usually leave it in place.
+  if (c == 1)
+    {
+      switch (stmt->classification())
+	{
+	case Statement::STATEMENT_ASSIGNMENT:
+	  // For an assignment statement, we need to evaluate an
+	  // expression on the right hand side before we evaluate any
+	  // index expression on the left hand side, so for that case
+	  // we always move the expression.  Otherwise we mishandle
+	  // m[0] = len(m) where m is a map.
+	  break;
+
+	case Statement::STATEMENT_EXPRESSION:
+	  {
+	    // If this is a call statement that doesn't return any
+	    // values, it will not have been counted as a value to
+	    // move.  We need to move any subexpressions in case they
+	    // are themselves call statements that require passing a
+	    // closure.
+	    Expression* expr = stmt->expression_statement()->expr();
+	    if (expr->call_expression() != NULL
+		&& expr->call_expression()->result_count() == 0)
+	      break;
+	    return TRAVERSE_CONTINUE;
+	  }
+
+	default:
+	  // We can leave the expression in place.
+	  return TRAVERSE_CONTINUE;
+	}
+    }
+
+  bool is_thunk = stmt->thunk_statement() != NULL;
+  Expression_statement* es = stmt->expression_statement();
+  for (Find_eval_ordering::const_iterator p = find_eval_ordering.begin();
+       p != find_eval_ordering.end();
+       ++p)
+    {
+      Expression** pexpr = *p;
+
+      // The last expression in a thunk will be the call passed to go
+      // or defer, which we must not evaluate early.
+      if (is_thunk && p + 1 == find_eval_ordering.end())
+	break;
+
+      Location loc = (*pexpr)->location();
+      Statement* s;
+      if ((*pexpr)->call_expression() == NULL
+	  || (*pexpr)->call_expression()->result_count() < 2)
+	{
+	  Temporary_statement* ts = Statement::make_temporary(NULL, *pexpr,
+							      loc);
+	  s = ts;
+	  *pexpr = Expression::make_temporary_reference(ts, loc);
+	}
+      else
+	{
+	  // A call expression which returns multiple results needs to
+	  // be handled specially.  We can't create a temporary
+	  // because there is no type to give it.  Any actual uses of
+	  // the values will be done via Call_result_expressions.
+          //
+          // Since a given call expression can be shared by multiple
+          // Call_result_expressions, avoid hoisting the call the
+          // second time we see it here. In addition, don't try to
+          // hoist the top-level multi-return call in the statement,
+          // since doing this would result a tree with more than one copy
+          // of the call.
+          if (this->remember_expression(*pexpr))
+            s = NULL;
+          else if (es != NULL && *pexpr == es->expr())
+            s = NULL;
+          else
+            s = Statement::make_statement(*pexpr, true);
+        }
+
+      if (s != NULL)
+        {
+          block->insert_statement_before(*pindex, s);
+          ++*pindex;
+        }
+    }
+
+  if (init != orig_init)
+    vds->var()->var_value()->set_init(init);
+
+  return TRAVERSE_CONTINUE;
+}
+
+// Implement the order of evaluation rules for the initializer of a
+// global variable.
+
+int
+Order_eval::variable(Named_object* no)
+{
+  if (no->is_result_variable())
+    return TRAVERSE_CONTINUE;
+  Variable* var = no->var_value();
+  Expression* init = var->init();
+  if (!var->is_global() || init == NULL)
+    return TRAVERSE_CONTINUE;
+
+  Find_eval_ordering find_eval_ordering;
+  Expression::traverse(&init, &find_eval_ordering);
+
+  if (find_eval_ordering.size() <= 1)
+    {
+      // If there is only one expression with a side-effect, we can
+      // leave it in place.
+      return TRAVERSE_SKIP_COMPONENTS;
+    }
+
+  Expression* orig_init = init;
+
+  for (Find_eval_ordering::const_iterator p = find_eval_ordering.begin();
+       p != find_eval_ordering.end();
+       ++p)
+    {
+      Expression** pexpr = *p;
+      Location loc = (*pexpr)->location();
+      Statement* s;
+      if ((*pexpr)->call_expression() == NULL
+	  || (*pexpr)->call_expression()->result_count() < 2)
+	{
+	  Temporary_statement* ts = Statement::make_temporary(NULL, *pexpr,
+							      loc);
+	  s = ts;
+	  *pexpr = Expression::make_temporary_reference(ts, loc);
+	}
+      else
+	{
+	  // A call expression which returns multiple results needs to
+	  // be handled specially.
+	  s = Statement::make_statement(*pexpr, true);
+	}
+      var->add_preinit_statement(this->gogo_, s);
+    }
+
+  if (init != orig_init)
+    var->set_init(init);
+
+  return TRAVERSE_SKIP_COMPONENTS;
+}
+
+// Use temporary variables to implement the order of evaluation rules.
+
+void
+Gogo::order_evaluations()
+{
+  Order_eval order_eval(this);
+  this->traverse(&order_eval);
+}
+
+// A traversal class used to find a single shortcut operator within an
+// expression.
+
+class Find_shortcut : public Traverse
+{
+ public:
+  Find_shortcut()
+    : Traverse(traverse_blocks
+	       | traverse_statements
+	       | traverse_expressions),
+      found_(NULL)
+  { }
+
+  // A pointer to the expression which was found, or NULL if none was
+  // found.
+  Expression**
+  found() const
+  { return this->found_; }
+
+ protected:
+  int
+  block(Block*)
+  { return TRAVERSE_SKIP_COMPONENTS; }
+
+  int
+  statement(Block*, size_t*, Statement*)
+  { return TRAVERSE_SKIP_COMPONENTS; }
+
+  int
+  expression(Expression**);
+
+ private:
+  Expression** found_;
+};
+
+// Find a shortcut expression.
+
+int
+Find_shortcut::expression(Expression** pexpr)
+{
+  Expression* expr = *pexpr;
+  Binary_expression* be = expr->binary_expression();
+  if (be == NULL)
+    return TRAVERSE_CONTINUE;
+  Operator op = be->op();
+  if (op != OPERATOR_OROR && op != OPERATOR_ANDAND)
+    return TRAVERSE_CONTINUE;
+  go_assert(this->found_ == NULL);
+  this->found_ = pexpr;
+  return TRAVERSE_EXIT;
+}
+
+// A traversal class used to turn shortcut operators into explicit if
+// statements.
+
+class Shortcuts : public Traverse
+{
+ public:
+  Shortcuts(Gogo* gogo)
+    : Traverse(traverse_variables
+	       | traverse_statements),
+      gogo_(gogo)
+  { }
+
+ protected:
+  int
+  variable(Named_object*);
+
+  int
+  statement(Block*, size_t*, Statement*);
+
+ private:
+  // Convert a shortcut operator.
+  Statement*
+  convert_shortcut(Block* enclosing, Expression** pshortcut);
+
+  // The IR.
+  Gogo* gogo_;
+};
+
+// Remove shortcut operators in a single statement.
+
+int
+Shortcuts::statement(Block* block, size_t* pindex, Statement* s)
+{
+  // FIXME: This approach doesn't work for switch statements, because
+  // we add the new statements before the whole switch when we need to
+  // instead add them just before the switch expression.  The right
+  // fix is probably to lower switch statements with nonconstant cases
+  // to a series of conditionals.
+  if (s->switch_statement() != NULL)
+    return TRAVERSE_CONTINUE;
+
+  while (true)
+    {
+      Find_shortcut find_shortcut;
+
+      // If S is a variable declaration, then ordinary traversal won't
+      // do anything.  We want to explicitly traverse the
+      // initialization expression if there is one.
+      Variable_declaration_statement* vds = s->variable_declaration_statement();
+      Expression* init = NULL;
+      if (vds == NULL)
 	s->traverse_contents(&find_shortcut);
       else
 	{
-	  init = vds->var()->var_value()->init();
-	  if (init == NULL)
-	    return TRAVERSE_CONTINUE;
-	  init->traverse(&init, &find_shortcut);
+	  init = vds->var()->var_value()->init();
+	  if (init == NULL)
+	    return TRAVERSE_CONTINUE;
+	  init->traverse(&init, &find_shortcut);
+	}
+      Expression** pshortcut = find_shortcut.found();
+      if (pshortcut == NULL)
+	return TRAVERSE_CONTINUE;
+
+      Statement* snew = this->convert_shortcut(block, pshortcut);
+      block->insert_statement_before(*pindex, snew);
+      ++*pindex;
+
+      if (pshortcut == &init)
+	vds->var()->var_value()->set_init(init);
+    }
+}
+
+// Remove shortcut operators in the initializer of a global variable.
+
+int
+Shortcuts::variable(Named_object* no)
+{
+  if (no->is_result_variable())
+    return TRAVERSE_CONTINUE;
+  Variable* var = no->var_value();
+  Expression* init = var->init();
+  if (!var->is_global() || init == NULL)
+    return TRAVERSE_CONTINUE;
+
+  while (true)
+    {
+      Find_shortcut find_shortcut;
+      init->traverse(&init, &find_shortcut);
+      Expression** pshortcut = find_shortcut.found();
+      if (pshortcut == NULL)
+	return TRAVERSE_CONTINUE;
+
+      Statement* snew = this->convert_shortcut(NULL, pshortcut);
+      var->add_preinit_statement(this->gogo_, snew);
+      if (pshortcut == &init)
+	var->set_init(init);
+    }
+}
+
+// Given an expression which uses a shortcut operator, return a
+// statement which implements it, and update *PSHORTCUT accordingly.
+
+Statement*
+Shortcuts::convert_shortcut(Block* enclosing, Expression** pshortcut)
+{
+  Binary_expression* shortcut = (*pshortcut)->binary_expression();
+  Expression* left = shortcut->left();
+  Expression* right = shortcut->right();
+  Location loc = shortcut->location();
+
+  Block* retblock = new Block(enclosing, loc);
+  retblock->set_end_location(loc);
+
+  Temporary_statement* ts = Statement::make_temporary(shortcut->type(),
+						      left, loc);
+  retblock->add_statement(ts);
+
+  Block* block = new Block(retblock, loc);
+  block->set_end_location(loc);
+  Expression* tmpref = Expression::make_temporary_reference(ts, loc);
+  Statement* assign = Statement::make_assignment(tmpref, right, loc);
+  block->add_statement(assign);
+
+  Expression* cond = Expression::make_temporary_reference(ts, loc);
+  if (shortcut->binary_expression()->op() == OPERATOR_OROR)
+    cond = Expression::make_unary(OPERATOR_NOT, cond, loc);
+
+  Statement* if_statement = Statement::make_if_statement(cond, block, NULL,
+							 loc);
+  retblock->add_statement(if_statement);
+
+  *pshortcut = Expression::make_temporary_reference(ts, loc);
+
+  delete shortcut;
+
+  // Now convert any shortcut operators in LEFT and RIGHT.
+  // LEFT and RIGHT were skipped in the top level
+  // Gogo::order_evaluations. We need to order their
+  // components first.
+  Order_eval order_eval(this->gogo_);
+  retblock->traverse(&order_eval);
+  Shortcuts shortcuts(this->gogo_);
+  retblock->traverse(&shortcuts);
+
+  return Statement::make_block_statement(retblock, loc);
+}
+
+// Turn shortcut operators into explicit if statements.  Doing this
+// considerably simplifies the order of evaluation rules.
+
+void
+Gogo::remove_shortcuts()
+{
+  Shortcuts shortcuts(this);
+  this->traverse(&shortcuts);
+}
+
+// Bounds check elimination.  This runs after the write barrier pass,
+// when we know which local variables have their address taken, and
+// before flattening, while index expressions still refer directly to
+// variables.  We walk each function in statement order keeping a set
+// of facts about values that can only change through an explicit
+// assignment in the function: local variables and temporaries whose
+// address is never taken.  A fact is forgotten when its value is
+// assigned, and facts established in a block are forgotten at a
+// label, since a label may be reached from elsewhere in the block.
+// Facts that were true on entry to a block and that involve only
+// values not assigned in the block hold throughout the block.
+
+// The -fgo-optimize-bce flag enables this pass.
+
+Go_optimize optimize_bce_flag("bce", true);
+
+// A key identifying a value tracked by bounds check elimination.
+// This is either a Named_object for a local variable or a
+// Temporary_statement.
+
+typedef const void* Bce_key;
+
+typedef std::set<Bce_key> Bce_keys;
+
+// Return the key for EXPR, or NULL if EXPR is not a value that we
+// track.
+
+static Bce_key
+bce_key(Expression* expr)
+{
+  Var_expression* ve = expr->var_expression();
+  if (ve != NULL)
+    {
+      Named_object* no = ve->named_object();
+      if (!no->is_variable())
+	return NULL;
+      Variable* var = no->var_value();
+      if (var->is_global()
+	  || var->is_address_taken()
+	  || var->is_non_escaping_address_taken())
+	return NULL;
+      return no;
+    }
+
+  Temporary_reference_expression* tre =
+    expr->temporary_reference_expression();
+  if (tre != NULL)
+    {
+      Temporary_statement* ts = tre->statement();
+      if (ts->is_address_taken())
+	return NULL;
+      return ts;
+    }
+
+  return NULL;
+}
+
+// If EXPR is a non-negative integer constant, set *VAL and return
+// true.
+
+static bool
+bce_constant(Expression* expr, int64_t* val)
+{
+  Numeric_constant nc;
+  unsigned long ul;
+  if (!expr->numeric_constant_value(&nc)
+      || nc.to_unsigned_long(&ul) != Numeric_constant::NC_UL_VALID)
+    return false;
+  int64_t v = static_cast<int64_t>(ul);
+  if (v < 0)
+    return false;
+  *val = v;
+  return true;
+}
+
+// If EXPR is a call to the predeclared function len applied to a
+// tracked value, return the key of the argument.
+
+static Bce_key
+bce_len_argument(Expression* expr)
+{
+  Call_expression* ce = expr->call_expression();
+  if (ce == NULL)
+    return NULL;
+  Builtin_call_expression* bce = ce->builtin_call_expression();
+  if (bce == NULL || bce->code() != Builtin_call_expression::BUILTIN_LEN)
+    return NULL;
+  const Expression_list* args = bce->args();
+  if (args == NULL || args->size() != 1)
+    return NULL;
+  return bce_key(args->front());
+}
+
+// The facts known at some point in a function.
+
+class Bce_facts
+{
+ public:
+  Bce_facts()
+    : in_bounds_(), min_len_(), upper_(), nonneg_(), value_(), len_(),
+      same_()
+  { }
+
+  // Record that 0 <= INDEX < len(ARRAY).
+  void
+  add_in_bounds(Bce_key array, Bce_key index)
+  { this->in_bounds_.insert(std::make_pair(array, index)); }
+
+  // Return whether 0 <= INDEX < len(ARRAY).
+  bool
+  is_in_bounds(Bce_key array, Bce_key index) const;
+
+  // Record that len(ARRAY) >= LEN.
+  void
+  add_min_len(Bce_key array, int64_t len);
+
+  // Return the known lower bound of len(ARRAY), or 0.
+  int64_t
+  min_len(Bce_key array) const;
+
+  // Record that 0 <= INDEX < BOUND.
+  void
+  add_upper(Bce_key index, int64_t bound);
+
+  // Return the known upper bound of INDEX, or 0 if there is none.
+  int64_t
+  upper(Bce_key index) const;
+
+  // Record that KEY >= 0.
+  void
+  add_nonneg(Bce_key key)
+  { this->nonneg_.insert(key); }
+
+  // Return whether KEY is known to be >= 0.
+  bool
+  is_nonneg(Bce_key key) const
+  { return this->nonneg_.find(key) != this->nonneg_.end(); }
+
+  // Record that KEY holds the constant VAL.
+  void
+  add_value(Bce_key key, int64_t val);
+
+  // If KEY is known to hold a constant, set *VAL and return true.
+  bool
+  value(Bce_key key, int64_t* val) const;
+
+  // Record that KEY == len(ARRAY).
+  void
+  add_len(Bce_key key, Bce_key array)
+  { this->len_[key] = array; }
+
+  // If KEY is known to be len of some array, return the array.
+  Bce_key
+  len_of(Bce_key key) const;
+
+  // Record the assignment DST = SRC.
+  void
+  assign(Bce_key dst, Bce_key src);
+
+  // Forget everything we know about KEY.
+  void
+  kill(Bce_key key);
+
+  // Forget everything we know about the values in KEYS.
+  void
+  kill(const Bce_keys& keys);
+
+ private:
+  typedef std::pair<Bce_key, Bce_key> Key_pair;
+  typedef std::set<Key_pair> Key_pairs;
+  typedef std::map<Bce_key, int64_t> Key_values;
+  typedef std::map<Bce_key, Bce_key> Key_map;
+
+  // Pairs (ARRAY, INDEX) with 0 <= INDEX < len(ARRAY).
+  Key_pairs in_bounds_;
+  // Known lower bounds of array lengths.
+  Key_values min_len_;
+  // Known upper bounds of indexes.
+  Key_values upper_;
+  // Values known to be non-negative.
+  Bce_keys nonneg_;
+  // Values known to be constant.
+  Key_values value_;
+  // Values known to be the length of some array.
+  Key_map len_;
+  // Pairs of values that are copies of the same slice or string.
+  Key_pairs same_;
+};
+
+// Return whether 0 <= INDEX < len(ARRAY), also considering copies of
+// ARRAY.
+
+bool
+Bce_facts::is_in_bounds(Bce_key array, Bce_key index) const
+{
+  if (this->in_bounds_.find(std::make_pair(array, index))
+      != this->in_bounds_.end())
+    return true;
+  for (Key_pairs::const_iterator p = this->same_.begin();
+       p != this->same_.end();
+       ++p)
+    {
+      if (p->first == array
+	  && (this->in_bounds_.find(std::make_pair(p->second, index))
+	      != this->in_bounds_.end()))
+	return true;
+    }
+  return false;
+}
+
+// Record a lower bound on the length of ARRAY.
+
+void
+Bce_facts::add_min_len(Bce_key array, int64_t len)
+{
+  Key_values::iterator p = this->min_len_.find(array);
+  if (p == this->min_len_.end())
+    this->min_len_[array] = len;
+  else if (p->second < len)
+    p->second = len;
+}
+
+// Return the known lower bound of the length of ARRAY, also
+// considering copies of ARRAY.
+
+int64_t
+Bce_facts::min_len(Bce_key array) const
+{
+  int64_t ret = 0;
+  Key_values::const_iterator p = this->min_len_.find(array);
+  if (p != this->min_len_.end())
+    ret = p->second;
+  for (Key_pairs::const_iterator ps = this->same_.begin();
+       ps != this->same_.end();
+       ++ps)
+    {
+      if (ps->first != array)
+	continue;
+      p = this->min_len_.find(ps->second);
+      if (p != this->min_len_.end() && p->second > ret)
+	ret = p->second;
+    }
+  return ret;
+}
+
+// Record an upper bound for INDEX.
+
+void
+Bce_facts::add_upper(Bce_key index, int64_t bound)
+{
+  Key_values::iterator p = this->upper_.find(index);
+  if (p == this->upper_.end())
+    this->upper_[index] = bound;
+  else if (p->second > bound)
+    p->second = bound;
+}
+
+// Return the known upper bound for INDEX.
+
+int64_t
+Bce_facts::upper(Bce_key index) const
+{
+  Key_values::const_iterator p = this->upper_.find(index);
+  if (p == this->upper_.end())
+    return 0;
+  return p->second;
+}
+
+// Record that KEY holds a constant value.
+
+void
+Bce_facts::add_value(Bce_key key, int64_t val)
+{
+  this->value_[key] = val;
+  this->nonneg_.insert(key);
+}
+
+// Get the constant value of KEY.
+
+bool
+Bce_facts::value(Bce_key key, int64_t* val) const
+{
+  Key_values::const_iterator p = this->value_.find(key);
+  if (p == this->value_.end())
+    return false;
+  *val = p->second;
+  return true;
+}
+
+// Return the array whose length is held in KEY, or NULL.
+
+Bce_key
+Bce_facts::len_of(Bce_key key) const
+{
+  Key_map::const_iterator p = this->len_.find(key);
+  if (p == this->len_.end())
+    return NULL;
+  return p->second;
+}
+
+// Record DST = SRC: everything we know about SRC is now known about
+// DST.  The caller is expected to have killed DST.
+
+void
+Bce_facts::assign(Bce_key dst, Bce_key src)
+{
+  if (dst == src)
+    return;
+
+  std::vector<Key_pair> add;
+  for (Key_pairs::const_iterator p = this->in_bounds_.begin();
+       p != this->in_bounds_.end();
+       ++p)
+    {
+      if (p->first == src)
+	add.push_back(std::make_pair(dst, p->second));
+      if (p->second == src)
+	add.push_back(std::make_pair(p->first, dst));
+    }
+  this->in_bounds_.insert(add.begin(), add.end());
+
+  add.clear();
+  for (Key_pairs::const_iterator p = this->same_.begin();
+       p != this->same_.end();
+       ++p)
+    {
+      if (p->first == src)
+	{
+	  add.push_back(std::make_pair(dst, p->second));
+	  add.push_back(std::make_pair(p->second, dst));
+	}
+    }
+  add.push_back(std::make_pair(dst, src));
+  add.push_back(std::make_pair(src, dst));
+  this->same_.insert(add.begin(), add.end());
+
+  Key_values::const_iterator pv = this->min_len_.find(src);
+  if (pv != this->min_len_.end())
+    this->min_len_[dst] = pv->second;
+  pv = this->upper_.find(src);
+  if (pv != this->upper_.end())
+    this->upper_[dst] = pv->second;
+  pv = this->value_.find(src);
+  if (pv != this->value_.end())
+    this->value_[dst] = pv->second;
+  if (this->nonneg_.find(src) != this->nonneg_.end())
+    this->nonneg_.insert(dst);
+  Key_map::const_iterator pm = this->len_.find(src);
+  if (pm != this->len_.end())
+    this->len_[dst] = pm->second;
+}
+
+// Forget everything we know about KEY.
+
+void
+Bce_facts::kill(Bce_key key)
+{
+  for (Key_pairs::iterator p = this->in_bounds_.begin();
+       p != this->in_bounds_.end();)
+    {
+      if (p->first == key || p->second == key)
+	this->in_bounds_.erase(p++);
+      else
+	++p;
+    }
+  for (Key_pairs::iterator p = this->same_.begin();
+       p != this->same_.end();)
+    {
+      if (p->first == key || p->second == key)
+	this->same_.erase(p++);
+      else
+	++p;
+    }
+  this->min_len_.erase(key);
+  this->upper_.erase(key);
+  this->value_.erase(key);
+  this->nonneg_.erase(key);
+  this->len_.erase(key);
+  for (Key_map::iterator p = this->len_.begin(); p != this->len_.end();)
+    {
+      if (p->second == key)
+	this->len_.erase(p++);
+      else
+	++p;
+    }
+}
+
+// Forget everything we know about the values in KEYS.
+
+void
+Bce_facts::kill(const Bce_keys& keys)
+{
+  for (Bce_keys::const_iterator p = keys.begin(); p != keys.end(); ++p)
+    this->kill(*p);
+}
+
+// Find the tracked values that may be assigned by a statement or a
+// block.  For statements that we don't understand we conservatively
+// assume that every tracked value they mention is assigned.
+
+class Bce_find_writes : public Traverse
+{
+ public:
+  Bce_find_writes(Bce_keys* writes)
+    : Traverse(traverse_statements
+	       | traverse_expressions),
+      writes_(writes), conservative_(0)
+  { }
+
+  int
+  statement(Block*, size_t*, Statement*);
+
+  int
+  expression(Expression**);
+
+ private:
+  void
+  add(Expression* expr)
+  {
+    Bce_key key = bce_key(expr);
+    if (key != NULL)
+      this->writes_->insert(key);
+  }
+
+  // The set of values that may be assigned.
+  Bce_keys* writes_;
+  // Greater than zero while walking a statement we don't understand.
+  int conservative_;
+};
+
+int
+Bce_find_writes::statement(Block*, size_t*, Statement* s)
+{
+  switch (s->classification())
+    {
+    case Statement::STATEMENT_ASSIGNMENT:
+      this->add(s->assignment_statement()->lhs());
+      break;
+
+    case Statement::STATEMENT_TEMPORARY:
+      this->writes_->insert(s->temporary_statement());
+      break;
+
+    case Statement::STATEMENT_VARIABLE_DECLARATION:
+      {
+	Named_object* var = s->variable_declaration_statement()->var();
+	this->writes_->insert(var);
+	// The initializer is not traversed as part of the statement.
+	Expression* init = var->var_value()->init();
+	if (init != NULL)
+	  Expression::traverse(&init, this);
+      }
+      break;
+
+    case Statement::STATEMENT_ERROR:
+    case Statement::STATEMENT_EXPRESSION:
+    case Statement::STATEMENT_BLOCK:
+    case Statement::STATEMENT_GO:
+    case Statement::STATEMENT_DEFER:
+    case Statement::STATEMENT_RETURN:
+    case Statement::STATEMENT_GOTO:
+    case Statement::STATEMENT_GOTO_UNNAMED:
+    case Statement::STATEMENT_LABEL:
+    case Statement::STATEMENT_UNNAMED_LABEL:
+    case Statement::STATEMENT_IF:
+    case Statement::STATEMENT_CONSTANT_SWITCH:
+    case Statement::STATEMENT_SEND:
+      break;
+
+    default:
+      ++this->conservative_;
+      if (s->traverse_contents(this) == TRAVERSE_EXIT)
+	return TRAVERSE_EXIT;
+      --this->conservative_;
+      return TRAVERSE_SKIP_COMPONENTS;
+    }
+  return TRAVERSE_CONTINUE;
+}
+
+int
+Bce_find_writes::expression(Expression** pexpr)
+{
+  Expression* expr = *pexpr;
+  Set_and_use_temporary_expression* sut =
+    expr->set_and_use_temporary_expression();
+  if (sut != NULL)
+    this->writes_->insert(sut->temporary());
+  else if (this->conservative_ > 0)
+    this->add(expr);
+  return TRAVERSE_CONTINUE;
+}
+
+// Find the index expressions that appear directly in a statement,
+// and the blocks nested within it.
+
+class Bce_find_indexes : public Traverse
+{
+ public:
+  Bce_find_indexes()
+    : Traverse(traverse_blocks
+	       | traverse_expressions),
+      indexes_(), blocks_(), conditional_(0)
+  { }
+
+  // An index expression and whether it is always evaluated when the
+  // statement is executed.
+  typedef std::vector<std::pair<Expression*, bool> > Indexes;
+
+  const Indexes&
+  indexes() const
+  { return this->indexes_; }
+
+  const std::vector<Block*>&
+  blocks() const
+  { return this->blocks_; }
+
+  int
+  block(Block* b)
+  {
+    this->blocks_.push_back(b);
+    return TRAVERSE_SKIP_COMPONENTS;
+  }
+
+  int
+  expression(Expression**);
+
+ private:
+  // The index expressions that we found.
+  Indexes indexes_;
+  // The nested blocks that we found.
+  std::vector<Block*> blocks_;
+  // Greater than zero while walking an expression that is only
+  // evaluated conditionally.
+  int conditional_;
+};
+
+int
+Bce_find_indexes::expression(Expression** pexpr)
+{
+  Expression* expr = *pexpr;
+  Binary_expression* be = expr->binary_expression();
+  if (expr->conditional_expression() != NULL
+      || (be != NULL
+	  && (be->op() == OPERATOR_ANDAND || be->op() == OPERATOR_OROR)))
+    {
+      ++this->conditional_;
+      if (expr->traverse_subexpressions(this) == TRAVERSE_EXIT)
+	return TRAVERSE_EXIT;
+      --this->conditional_;
+      return TRAVERSE_SKIP_COMPONENTS;
+    }
+
+  if (expr->array_index_expression() != NULL
+      || expr->string_index_expression() != NULL)
+    this->indexes_.push_back(std::make_pair(expr, this->conditional_ == 0));
+
+  return TRAVERSE_CONTINUE;
+}
+
+// A flow-sensitive walk over the statements of a function, shared by
+// the bounds check and nil check elimination passes.  FACTS is the
+// type that records what is known at a point in the function.  The
+// walk is conservative: a label discards everything learned since the
+// start of the enclosing block, and a value assigned anywhere in a
+// block is not trusted anywhere in that block.  The child class
+// decides what each statement and condition tells us.
+
+template<typename Facts>
+class Flow_function
+{
+ public:
+  virtual ~Flow_function()
+  { }
+
+  // Walk the statements of B.  FLOW holds the facts known on entry,
+  // and is updated to the facts known if B falls through.
+  void
+  block(Block* b, Facts* flow);
+
+ protected:
+  void
+  statement(Statement*, const Facts& invariant, Facts* flow);
+
+  void
+  if_statement(If_statement*, Facts* flow);
+
+  void
+  writes(Block*, Bce_keys*);
+
+  void
+  writes(Statement*, Bce_keys*);
+
+  // Walk a block statement in a special way.  Return false to walk it
+  // as an ordinary block.
+  virtual bool
+  block_statement(Block_statement*, Facts*)
+  { return false; }
+
+  // Look at the expressions directly within a statement, given the
+  // facts known before it.  Add the facts established by the
+  // statement to FLOW.  WRITES are the values assigned by the
+  // statement.  Store nested blocks in BLOCKS.
+  virtual void
+  check_statement(Statement*, const Facts& facts, Facts* flow,
+		  const Bce_keys& writes, std::vector<Block*>* blocks) = 0;
+
+  // Record that a value, already killed, has been set to an
+  // expression.
+  virtual void
+  record_assignment(Bce_key, Expression*, Facts*) = 0;
+
+  // Add what we learn from knowing that a condition has a given value.
+  virtual void
+  add_condition(Expression*, bool, Facts*) = 0;
+
+  // Forget everything known about some values.
+  virtual void
+  kill(const Bce_keys&, Facts*) = 0;
+
+  // Set FLOW to the facts known after an if statement when both
+  // branches fall through.  FLOW holds the facts known after the
+  // condition.
+  virtual void
+  join(Block* then_block, const Facts& then_facts, Block* else_block,
+       const Facts& else_facts, Facts* flow) = 0;
+};
+
+// Collect the values assigned anywhere in B.
+
+template<typename Facts>
+void
+Flow_function<Facts>::writes(Block* b, Bce_keys* keys)
+{
+  Bce_find_writes find_writes(keys);
+  b->traverse(&find_writes);
+}
+
+// Collect the values assigned anywhere in S.
+
+template<typename Facts>
+void
+Flow_function<Facts>::writes(Statement* s, Bce_keys* keys)
+{
+  Bce_find_writes find_writes(keys);
+  if (find_writes.statement(NULL, NULL, s) == TRAVERSE_CONTINUE)
+    s->traverse_contents(&find_writes);
+}
+
+// Walk a block.
+
+template<typename Facts>
+void
+Flow_function<Facts>::block(Block* b, Facts* flow)
+{
+  Bce_keys written;
+  this->writes(b, &written);
+  Facts invariant(*flow);
+  this->kill(written, &invariant);
+
+  const std::vector<Statement*>* stmts = b->statements();
+  for (std::vector<Statement*>::const_iterator p = stmts->begin();
+       p != stmts->end();
+       ++p)
+    this->statement(*p, invariant, flow);
+}
+
+// Walk a statement.  INVARIANT holds the facts known throughout the
+// enclosing block.  FLOW holds the facts known before the statement,
+// and is updated to the facts known after it.
+
+template<typename Facts>
+void
+Flow_function<Facts>::statement(Statement* s, const Facts& invariant,
+				Facts* flow)
+{
+  switch (s->classification())
+    {
+    case Statement::STATEMENT_LABEL:
+    case Statement::STATEMENT_UNNAMED_LABEL:
+      // A label may be reached from anywhere in the block.
+      *flow = invariant;
+      return;
+
+    case Statement::STATEMENT_BLOCK:
+      {
+	Block_statement* bs = s->block_statement();
+	if (!this->block_statement(bs, flow))
+	  this->block(bs->block(), flow);
+      }
+      return;
+
+    case Statement::STATEMENT_IF:
+      this->if_statement(s->if_statement(), flow);
+      return;
+
+    default:
+      break;
+    }
+
+  Bce_keys written;
+  this->writes(s, &written);
+
+  std::vector<Block*> blocks;
+  Facts before(*flow);
+  this->check_statement(s, before, flow, written, &blocks);
+
+  // Nested blocks, as in a select statement, start with the facts
+  // that the statement itself can not change.
+  if (!blocks.empty())
+    {
+      Facts inner(before);
+      this->kill(written, &inner);
+      for (std::vector<Block*>::const_iterator p = blocks.begin();
+	   p != blocks.end();
+	   ++p)
+	{
+	  Facts f(inner);
+	  this->block(*p, &f);
+	}
+    }
+
+  Assignment_statement* as = s->assignment_statement();
+  Temporary_statement* ts = s->temporary_statement();
+  Variable_declaration_statement* vds = s->variable_declaration_statement();
+  if (as != NULL)
+    {
+      Bce_key key = bce_key(as->lhs());
+      if (key != NULL)
+	this->record_assignment(key, as->rhs(), flow);
+    }
+  else if (ts != NULL)
+    {
+      if (!ts->is_address_taken() && ts->init() != NULL)
+	this->record_assignment(ts, ts->init(), flow);
+    }
+  else if (vds != NULL)
+    {
+      Named_object* var = vds->var();
+      Variable* v = var->var_value();
+      if (!v->is_address_taken()
+	  && !v->is_non_escaping_address_taken()
+	  && v->init() != NULL)
+	this->record_assignment(var, v->init(), flow);
+    }
+}
+
+// Walk an if statement.
+
+template<typename Facts>
+void
+Flow_function<Facts>::if_statement(If_statement* is, Facts* flow)
+{
+  Expression* cond = is->condition();
+  Bce_keys written;
+  Bce_find_writes find_writes(&written);
+  Expression::traverse(&cond, &find_writes);
+
+  std::vector<Block*> blocks;
+  Facts before(*flow);
+  this->check_statement(is, before, flow, written, &blocks);
+
+  Block* then_block = is->then_block();
+  Block* else_block = is->else_block();
+
+  Facts then_facts(*flow);
+  this->add_condition(cond, true, &then_facts);
+  this->block(then_block, &then_facts);
+
+  Facts else_facts(*flow);
+  this->add_condition(cond, false, &else_facts);
+  if (else_block != NULL)
+    this->block(else_block, &else_facts);
+
+  bool then_falls_through = then_block->may_fall_through();
+  bool else_falls_through = (else_block == NULL
+			     || else_block->may_fall_through());
+  if (then_falls_through && else_falls_through)
+    this->join(then_block, then_facts, else_block, else_facts, flow);
+  else if (then_falls_through)
+    *flow = then_facts;
+  else if (else_falls_through)
+    *flow = else_facts;
+}
+
+// Eliminate bounds checks in a single function.
+
+class Bce_function : public Flow_function<Bce_facts>
+{
+ public:
+  Bce_function(Gogo* gogo)
+    : gogo_(gogo)
+  { }
+
+ protected:
+  bool
+  block_statement(Block_statement*, Bce_facts* flow);
+
+  void
+  check_statement(Statement*, const Bce_facts& facts, Bce_facts* flow,
+		  const Bce_keys& writes, std::vector<Block*>* blocks);
+
+  void
+  record_assignment(Bce_key, Expression*, Bce_facts*);
+
+  void
+  add_condition(Expression*, bool, Bce_facts*);
+
+  void
+  kill(const Bce_keys& keys, Bce_facts* facts)
+  { facts->kill(keys); }
+
+  void
+  join(Block* then_block, const Bce_facts&, Block* else_block,
+       const Bce_facts&, Bce_facts* flow);
+
+ private:
+  bool
+  lowered_for(Block*, Bce_facts* flow);
+
+  bool
+  check_index(Expression*, const Bce_facts&, Bce_key* parray,
+	      Bce_key* pindex, int64_t* pconst);
+
+  Bce_key
+  len_key(Expression*, const Bce_facts&);
+
+  // The IR.
+  Gogo* gogo_;
+};
+
+// Walk a lowered for statement specially, if we can.
+
+bool
+Bce_function::block_statement(Block_statement* bs, Bce_facts* flow)
+{
+  return (bs->is_lowered_for_statement()
+	  && this->lowered_for(bs->block(), flow));
+}
+
+// Record that the value KEY has been set to RHS.  KEY has already
+// been killed.
+
+void
+Bce_function::record_assignment(Bce_key key, Expression* rhs,
+				Bce_facts* flow)
+{
+  int64_t val;
+  Bce_key array;
+  Bce_key src = bce_key(rhs);
+  if (src != NULL)
+    flow->assign(key, src);
+  else if (bce_constant(rhs, &val))
+    flow->add_value(key, val);
+  else if ((array = bce_len_argument(rhs)) != NULL)
+    {
+      flow->add_len(key, array);
+      flow->add_nonneg(key);
+    }
+}
+
+// Look at the index expressions directly within S.  FACTS are the
+// facts known before S.  Add the facts established by the statement
+// to FLOW.  WRITES are the values assigned by S.  Store nested blocks
+// in BLOCKS.
+
+void
+Bce_function::check_statement(Statement* s, const Bce_facts& facts,
+			      Bce_facts* flow, const Bce_keys& writes,
+			      std::vector<Block*>* blocks)
+{
+  Bce_find_indexes find_indexes;
+  Variable_declaration_statement* vds = s->variable_declaration_statement();
+  if (vds == NULL)
+    s->traverse_contents(&find_indexes);
+  else
+    {
+      Expression* init = vds->var()->var_value()->init();
+      if (init != NULL)
+	Expression::traverse(&init, &find_indexes);
+    }
+
+  // For a simple assignment the values are assigned after all the
+  // expressions are evaluated, so we can use everything we know.
+  // For anything else, ignore what we know about values assigned by
+  // the statement.
+  const Bce_facts* use = &facts;
+  Bce_facts limited;
+  if (s->assignment_statement() == NULL
+      && s->temporary_statement() == NULL
+      && vds == NULL
+      && !writes.empty())
+    {
+      limited = facts;
+      limited.kill(writes);
+      use = &limited;
+    }
+
+  flow->kill(writes);
+
+  const Bce_find_indexes::Indexes& indexes(find_indexes.indexes());
+  for (Bce_find_indexes::Indexes::const_iterator p = indexes.begin();
+       p != indexes.end();
+       ++p)
+    {
+      Bce_key array;
+      Bce_key index;
+      int64_t c;
+      this->check_index(p->first, *use, &array, &index, &c);
+
+      // If the index is always evaluated, then after the statement
+      // we know that it was in bounds, or we would have panicked.
+      if (!p->second
+	  || (array != NULL && writes.find(array) != writes.end())
+	  || (index != NULL && writes.find(index) != writes.end()))
+	continue;
+      if (index != NULL)
+	{
+	  flow->add_nonneg(index);
+	  if (array != NULL)
+	    flow->add_in_bounds(array, index);
+	}
+      else if (array != NULL
+	       && c >= 0
+	       && c < std::numeric_limits<int64_t>::max())
+	flow->add_min_len(array, c + 1);
+    }
+
+  *blocks = find_indexes.blocks();
+}
+
+// Decide whether the index expression EXPR needs a bounds check,
+// given FACTS, and mark it accordingly.  Set *PARRAY and *PINDEX to
+// the keys of the array and index, or NULL.  Set *PCONST to a
+// constant index, or -1.  Return whether the check was eliminated.
+
+bool
+Bce_function::check_index(Expression* expr, const Bce_facts& facts,
+			  Bce_key* parray, Bce_key* pindex, int64_t* pconst)
+{
+  *parray = NULL;
+  *pindex = NULL;
+  *pconst = -1;
+
+  Array_index_expression* aie = expr->array_index_expression();
+  String_index_expression* sie = expr->string_index_expression();
+  Expression* array;
+  Expression* start;
+  Expression* end;
+  int64_t len = -1;
+  if (aie != NULL)
+    {
+      array = aie->array();
+      start = aie->start();
+      end = aie->end();
+      Array_type* at = array->type()->array_type();
+      if (at == NULL)
+	return false;
+      if (at->length() != NULL && !at->int_length(&len))
+	len = -1;
+    }
+  else
+    {
+      array = sie->string();
+      start = sie->start();
+      end = sie->end();
+      std::string sval;
+      if (array->string_constant_value(&sval))
+	len = sval.length();
+    }
+
+  bool debug = this->gogo_->debug_optimization();
+  if (end != NULL)
+    {
+      // We only handle simple indexing.
+      if (debug)
+	go_inform(expr->location(), "slice bounds check remains");
+      return false;
+    }
+
+  *parray = bce_key(array);
+  *pindex = bce_key(start);
+  bce_constant(start, pconst);
+
+  int64_t min_len = len;
+  if (*parray != NULL && facts.min_len(*parray) > min_len)
+    min_len = facts.min_len(*parray);
+
+  bool ok = false;
+  if (*pconst >= 0)
+    ok = *pconst < min_len;
+  else if (*pindex != NULL)
+    {
+      int64_t upper = facts.upper(*pindex);
+      ok = ((*parray != NULL && facts.is_in_bounds(*parray, *pindex))
+	    || (upper > 0 && upper <= min_len));
+    }
+
+  if (ok)
+    {
+      if (aie != NULL)
+	aie->set_needs_bounds_check(false);
+      else
+	sie->set_needs_bounds_check(false);
+    }
+
+  if (debug)
+    go_inform(expr->location(),
+	      (ok
+	       ? "index bounds check eliminated"
+	       : "index bounds check remains"));
+
+  return ok;
+}
+
+// If EXPR is len(A) for some array A, or a value known to hold
+// len(A), return the key for A.
+
+Bce_key
+Bce_function::len_key(Expression* expr, const Bce_facts& facts)
+{
+  Bce_key array = bce_len_argument(expr);
+  if (array != NULL)
+    return array;
+  Bce_key key = bce_key(expr);
+  if (key != NULL)
+    return facts.len_of(key);
+  return NULL;
+}
+
+// Add to FACTS what we learn from knowing that COND is TRUTH.
+
+void
+Bce_function::add_condition(Expression* cond, bool truth, Bce_facts* facts)
+{
+  Unary_expression* ue = cond->unary_expression();
+  if (ue != NULL && ue->op() == OPERATOR_NOT)
+    {
+      this->add_condition(ue->operand(), !truth, facts);
+      return;
+    }
+
+  Binary_expression* be = cond->binary_expression();
+  if (be == NULL)
+    return;
+  Operator op = be->op();
+  Expression* left = be->left();
+  Expression* right = be->right();
+
+  // Turn the comparison into LEFT < RIGHT or LEFT <= RIGHT.
+  if (!truth)
+    {
+      switch (op)
+	{
+	case OPERATOR_LT:
+	  op = OPERATOR_GE;
+	  break;
+	case OPERATOR_LE:
+	  op = OPERATOR_GT;
+	  break;
+	case OPERATOR_GT:
+	  op = OPERATOR_LE;
+	  break;
+	case OPERATOR_GE:
+	  op = OPERATOR_LT;
+	  break;
+	default:
+	  return;
 	}
-      Expression** pshortcut = find_shortcut.found();
-      if (pshortcut == NULL)
-	return TRAVERSE_CONTINUE;
+    }
+  if (op == OPERATOR_GT || op == OPERATOR_GE)
+    {
+      std::swap(left, right);
+      op = op == OPERATOR_GT ? OPERATOR_LT : OPERATOR_LE;
+    }
+  if (op != OPERATOR_LT && op != OPERATOR_LE)
+    return;
 
-      Statement* snew = this->convert_shortcut(block, pshortcut);
-      block->insert_statement_before(*pindex, snew);
-      ++*pindex;
+  Bce_key array = this->len_key(right, *facts);
+  int64_t c;
+  if (array != NULL && bce_constant(left, &c))
+    {
+      // c < len(A) or c <= len(A).  Take care not to overflow.
+      if (op == OPERATOR_LE)
+	facts->add_min_len(array, c);
+      else if (c < std::numeric_limits<int64_t>::max())
+	facts->add_min_len(array, c + 1);
+      return;
+    }
+
+  Bce_key index = bce_key(left);
+  if (index == NULL)
+    return;
+  Type* itype = left->type();
+  if (!facts->is_nonneg(index)
+      && (itype->integer_type() == NULL
+	  || !itype->integer_type()->is_unsigned()))
+    return;
+
+  if (array != NULL && op == OPERATOR_LT)
+    {
+      facts->add_in_bounds(array, index);
+      facts->add_nonneg(index);
+    }
+  else if (bce_constant(right, &c)
+	   && (op == OPERATOR_LT || c < std::numeric_limits<int64_t>::max()))
+    {
+      facts->add_upper(index, op == OPERATOR_LT ? c : c + 1);
+      facts->add_nonneg(index);
+    }
+}
+
+// After an if statement whose branches both fall through, we know
+// what we knew after the condition, less anything either branch
+// changes.
+
+void
+Bce_function::join(Block* then_block, const Bce_facts&, Block* else_block,
+		   const Bce_facts&, Bce_facts* flow)
+{
+  Bce_keys branch_writes;
+  this->writes(then_block, &branch_writes);
+  if (else_block != NULL)
+    this->writes(else_block, &branch_writes);
+  flow->kill(branch_writes);
+}
+
+// Walk a lowered for statement.  This recognizes loops of the form
+//   for INIT; I < BOUND; I = I + 1 { BODY }
+// where I starts out non-negative, BODY does not change I, and BOUND
+// is a constant, a call to len, or a value known to hold a length
+// that does not change in the loop.  Return false if this does not
+// look like a lowered for statement; the caller will treat it as an
+// ordinary block.
+
+bool
+Bce_function::lowered_for(Block* b, Bce_facts* flow)
+{
+  // The statements of a lowered for statement are, in order,
+  //   INIT (optional), goto ENTRY (if there is a condition), TOP:,
+  //   BODY, CONTINUE: (optional), POST (optional), and then either
+  //   ENTRY: if COND { goto TOP } or goto TOP, and finally BREAK:
+  //   (optional).
+  const std::vector<Statement*>* stmts = b->statements();
+  size_t n = stmts->size();
+  size_t i = 0;
+
+  Block* init = NULL;
+  if (i < n && (*stmts)[i]->block_statement() != NULL)
+    {
+      init = (*stmts)[i]->block_statement()->block();
+      ++i;
+    }
+
+  Unnamed_label* entry = NULL;
+  if (i < n && (*stmts)[i]->goto_unnamed_statement() != NULL)
+    {
+      entry = (*stmts)[i]->goto_unnamed_statement()->unnamed_label();
+      ++i;
+    }
+
+  if (i >= n || (*stmts)[i]->unnamed_label_statement() == NULL)
+    return false;
+  ++i;
+
+  if (i >= n || (*stmts)[i]->block_statement() == NULL)
+    return false;
+  Block* body = (*stmts)[i]->block_statement()->block();
+  ++i;
+
+  if (i < n
+      && (*stmts)[i]->unnamed_label_statement() != NULL
+      && (*stmts)[i]->unnamed_label_statement()->unnamed_label() != entry)
+    ++i;
+
+  Block* post = NULL;
+  if (i < n && (*stmts)[i]->block_statement() != NULL)
+    {
+      post = (*stmts)[i]->block_statement()->block();
+      ++i;
+    }
+
+  If_statement* cond_if = NULL;
+  if (entry != NULL)
+    {
+      if (i + 1 >= n
+	  || (*stmts)[i]->unnamed_label_statement() == NULL
+	  || (*stmts)[i]->unnamed_label_statement()->unnamed_label() != entry
+	  || (*stmts)[i + 1]->if_statement() == NULL)
+	return false;
+      cond_if = (*stmts)[i + 1]->if_statement();
+    }
+
+  // The initialization statements are executed once, in order.
+  if (init != NULL)
+    this->block(init, flow);
+
+  // Everything that may change in the loop.
+  Bce_keys loop_writes;
+  this->writes(body, &loop_writes);
+  Bce_keys body_writes(loop_writes);
+  if (post != NULL)
+    this->writes(post, &loop_writes);
+  if (cond_if != NULL)
+    this->writes(cond_if, &loop_writes);
+
+  Bce_facts loop_facts(*flow);
+  loop_facts.kill(loop_writes);
+
+  // Look for the induction variable.
+  Bce_facts body_facts(loop_facts);
+  Binary_expression* cmp = (cond_if == NULL
+			    ? NULL
+			    : cond_if->condition()->binary_expression());
+  Assignment_statement* incr = NULL;
+  if (post != NULL && post->statements()->size() == 1)
+    incr = post->statements()->front()->assignment_statement();
+  if (cmp != NULL && incr != NULL)
+    {
+      Expression* left = cmp->left();
+      Expression* right = cmp->right();
+      if (cmp->op() == OPERATOR_GT)
+	std::swap(left, right);
+      Bce_key index = bce_key(left);
+      Binary_expression* plus = incr->rhs()->binary_expression();
+      int64_t one;
+      if ((cmp->op() == OPERATOR_LT || cmp->op() == OPERATOR_GT)
+	  && index != NULL
+	  && body_writes.find(index) == body_writes.end()
+	  && bce_key(incr->lhs()) == index
+	  && plus != NULL
+	  && plus->op() == OPERATOR_PLUS
+	  && bce_key(plus->left()) == index
+	  && bce_constant(plus->right(), &one)
+	  && one == 1
+	  && (flow->is_nonneg(index)
+	      || (left->type()->integer_type() != NULL
+		  && left->type()->integer_type()->is_unsigned())))
+	{
+	  // The loop condition guarantees that incrementing the index
+	  // does not overflow.  Use the facts before the loop to find
+	  // the bound, and make sure it does not change in the loop.
+	  Bce_key array = this->len_key(right, *flow);
+	  Bce_key bound = bce_key(right);
+	  int64_t c;
+	  if (array != NULL
+	      && loop_writes.find(array) == loop_writes.end()
+	      && (bound == NULL || loop_writes.find(bound) == loop_writes.end()))
+	    {
+	      body_facts.add_in_bounds(array, index);
+	      body_facts.add_nonneg(index);
+	    }
+	  else if (bce_constant(right, &c)
+		   || (bound != NULL
+		       && loop_writes.find(bound) == loop_writes.end()
+		       && flow->value(bound, &c)))
+	    {
+	      body_facts.add_upper(index, c);
+	      body_facts.add_nonneg(index);
+	    }
+	}
+    }
+
+  this->block(body, &body_facts);
+
+  // Walk the post statement and condition for the benefit of the
+  // debugging output.
+  if (post != NULL)
+    {
+      Bce_facts f(loop_facts);
+      this->block(post, &f);
+    }
+  if (cond_if != NULL)
+    {
+      Bce_facts f(loop_facts);
+      this->if_statement(cond_if, &f);
+    }
+
+  *flow = loop_facts;
+  return true;
+}
+
+// Traverse the functions in the program looking for bounds checks
+// to eliminate.
+
+class Eliminate_bounds_checks : public Traverse
+{
+ public:
+  Eliminate_bounds_checks(Gogo* gogo)
+    : Traverse(traverse_functions),
+      gogo_(gogo)
+  { }
+
+  int
+  function(Named_object*);
+
+ private:
+  Gogo* gogo_;
+};
+
+int
+Eliminate_bounds_checks::function(Named_object* no)
+{
+  Bce_function bce(this->gogo_);
+  Bce_facts facts;
+  bce.block(no->func_value()->block(), &facts);
+  return TRAVERSE_SKIP_COMPONENTS;
+}
+
+// Remove array and string index bounds checks that are known to
+// succeed.
+
+void
+Gogo::eliminate_bounds_checks()
+{
+  if (!optimize_bce_flag.is_enabled())
+    return;
+  Eliminate_bounds_checks ebc(this);
+  this->traverse(&ebc);
+}
+
+// Nil check elimination.  An explicit nil check is required when
+// dereferencing a pointer to a large type, or when taking the address
+// of a field of a dereferenced pointer.  Once a pointer has been
+// checked it can not become nil again until it is assigned, so later
+// checks of the same pointer are unnecessary.  This pass tracks the
+// same values as bounds check elimination, and uses the same block
+// structured walk: facts are established by explicit nil checks, by
+// assigning a newly allocated value or the address of a variable, by
+// copying a value already known to be non-nil, and by comparisons
+// with nil in if statements.
+
+// The -fgo-optimize-nilcheck flag enables this pass.
+
+Go_optimize optimize_nilcheck_flag("nilcheck", true);
+
+// Find the dereferences that appear directly in a statement, and the
+// blocks nested within it.
+
+class Nil_find_derefs : public Traverse
+{
+ public:
+  Nil_find_derefs()
+    : Traverse(traverse_blocks
+	       | traverse_expressions),
+      derefs_(), blocks_(), conditional_(0)
+  { }
+
+  // A dereference and whether it is always evaluated when the
+  // statement is executed.
+  typedef std::vector<std::pair<Unary_expression*, bool> > Derefs;
+
+  const Derefs&
+  derefs() const
+  { return this->derefs_; }
+
+  const std::vector<Block*>&
+  blocks() const
+  { return this->blocks_; }
+
+  int
+  block(Block* b)
+  {
+    this->blocks_.push_back(b);
+    return TRAVERSE_SKIP_COMPONENTS;
+  }
+
+  int
+  expression(Expression**);
+
+ private:
+  // The dereferences that we found.
+  Derefs derefs_;
+  // The nested blocks that we found.
+  std::vector<Block*> blocks_;
+  // Greater than zero while walking an expression that is only
+  // evaluated conditionally.
+  int conditional_;
+};
+
+int
+Nil_find_derefs::expression(Expression** pexpr)
+{
+  Expression* expr = *pexpr;
+  Binary_expression* be = expr->binary_expression();
+  if (expr->conditional_expression() != NULL
+      || (be != NULL
+	  && (be->op() == OPERATOR_ANDAND || be->op() == OPERATOR_OROR)))
+    {
+      ++this->conditional_;
+      if (expr->traverse_subexpressions(this) == TRAVERSE_EXIT)
+	return TRAVERSE_EXIT;
+      --this->conditional_;
+      return TRAVERSE_SKIP_COMPONENTS;
+    }
+
+  Unary_expression* ue = expr->unary_expression();
+  if (ue != NULL
+      && ue->op() == OPERATOR_MULT
+      && bce_key(ue->operand()) != NULL)
+    this->derefs_.push_back(std::make_pair(ue, this->conditional_ == 0));
+
+  return TRAVERSE_CONTINUE;
+}
+
+// Eliminate nil checks in a single function.  The facts are the set
+// of values known to be non-nil.
+
+class Nil_check_function : public Flow_function<Bce_keys>
+{
+ public:
+  typedef Bce_keys Facts;
+
+  Nil_check_function(Gogo* gogo)
+    : gogo_(gogo), removed_(0), remaining_(0)
+  { }
+
+  // The number of nil checks removed.
+  int
+  removed() const
+  { return this->removed_; }
+
+  // The number of nil checks that remain.
+  int
+  remaining() const
+  { return this->remaining_; }
+
+ protected:
+  void
+  check_statement(Statement*, const Facts& facts, Facts* flow,
+		  const Bce_keys& writes, std::vector<Block*>* blocks);
+
+  void
+  record_assignment(Bce_key, Expression*, Facts*);
+
+  void
+  add_condition(Expression*, bool, Facts*);
+
+  void
+  kill(const Bce_keys& keys, Facts* facts);
+
+  void
+  join(Block*, const Facts& then_facts, Block*, const Facts& else_facts,
+       Facts* flow);
+
+ private:
+  // The IR.
+  Gogo* gogo_;
+  // The number of nil checks removed.
+  int removed_;
+  // The number of nil checks that remain.
+  int remaining_;
+};
+
+// Remove KEYS from FACTS.
+
+void
+Nil_check_function::kill(const Bce_keys& keys, Facts* facts)
+{
+  for (Bce_keys::const_iterator p = keys.begin(); p != keys.end(); ++p)
+    facts->erase(*p);
+}
 
-      if (pshortcut == &init)
-	vds->var()->var_value()->set_init(init);
-    }
+// Record that KEY has been set to RHS.  KEY has already been removed
+// from FLOW.
+
+void
+Nil_check_function::record_assignment(Bce_key key, Expression* rhs,
+				      Facts* flow)
+{
+  Unary_expression* ue = rhs->unary_expression();
+  Bce_key src = bce_key(rhs);
+  if (rhs->allocation_expression() != NULL
+      || rhs->heap_expression() != NULL
+      || (ue != NULL && ue->op() == OPERATOR_AND)
+      || (src != NULL && flow->find(src) != flow->end()))
+    flow->insert(key);
 }
 
-// Remove shortcut operators in the initializer of a global variable.
+// Look at the dereferences directly within S.  FACTS are the facts
+// known before S.  Add the facts established by the statement to
+// FLOW.  WRITES are the values assigned by S.  Store nested blocks in
+// BLOCKS.
 
-int
-Shortcuts::variable(Named_object* no)
+void
+Nil_check_function::check_statement(Statement* s, const Facts& facts,
+				    Facts* flow, const Bce_keys& writes,
+				    std::vector<Block*>* blocks)
 {
-  if (no->is_result_variable())
-    return TRAVERSE_CONTINUE;
-  Variable* var = no->var_value();
-  Expression* init = var->init();
-  if (!var->is_global() || init == NULL)
-    return TRAVERSE_CONTINUE;
+  Nil_find_derefs find_derefs;
+  Variable_declaration_statement* vds = s->variable_declaration_statement();
+  if (vds == NULL)
+    s->traverse_contents(&find_derefs);
+  else
+    {
+      Expression* init = vds->var()->var_value()->init();
+      if (init != NULL)
+	Expression::traverse(&init, &find_derefs);
+    }
 
-  while (true)
+  // As with bounds checks, the values set by a simple assignment are
+  // only changed after all the expressions are evaluated.
+  const Facts* use = &facts;
+  Facts limited;
+  if (s->assignment_statement() == NULL
+      && s->temporary_statement() == NULL
+      && vds == NULL
+      && !writes.empty())
     {
-      Find_shortcut find_shortcut;
-      init->traverse(&init, &find_shortcut);
-      Expression** pshortcut = find_shortcut.found();
-      if (pshortcut == NULL)
-	return TRAVERSE_CONTINUE;
+      limited = facts;
+      this->kill(writes, &limited);
+      use = &limited;
+    }
 
-      Statement* snew = this->convert_shortcut(NULL, pshortcut);
-      var->add_preinit_statement(this->gogo_, snew);
-      if (pshortcut == &init)
-	var->set_init(init);
+  this->kill(writes, flow);
+
+  const Nil_find_derefs::Derefs& derefs(find_derefs.derefs());
+  for (Nil_find_derefs::Derefs::const_iterator p = derefs.begin();
+       p != derefs.end();
+       ++p)
+    {
+      Unary_expression* ue = p->first;
+      Unary_expression::Nil_check_classification c =
+	ue->requires_nil_check(this->gogo_);
+      if (c != Unary_expression::NIL_CHECK_NEEDED)
+	continue;
+
+      Bce_key key = bce_key(ue->operand());
+      if (use->find(key) != use->end())
+	{
+	  ue->set_requires_nil_check(false);
+	  ++this->removed_;
+	}
+      else
+	{
+	  ++this->remaining_;
+	  // After an unconditional check the value is not nil, or we
+	  // would have panicked.
+	  if (p->second && writes.find(key) == writes.end())
+	    flow->insert(key);
+	}
     }
+
+  *blocks = find_derefs.blocks();
 }
 
-// Given an expression which uses a shortcut operator, return a
-// statement which implements it, and update *PSHORTCUT accordingly.
+// Add to FACTS what we learn from knowing that COND is TRUTH.
 
-Statement*
-Shortcuts::convert_shortcut(Block* enclosing, Expression** pshortcut)
+void
+Nil_check_function::add_condition(Expression* cond, bool truth,
+				  Facts* facts)
 {
-  Binary_expression* shortcut = (*pshortcut)->binary_expression();
-  Expression* left = shortcut->left();
-  Expression* right = shortcut->right();
-  Location loc = shortcut->location();
+  Unary_expression* ue = cond->unary_expression();
+  if (ue != NULL && ue->op() == OPERATOR_NOT)
+    {
+      this->add_condition(ue->operand(), !truth, facts);
+      return;
+    }
 
-  Block* retblock = new Block(enclosing, loc);
-  retblock->set_end_location(loc);
+  Binary_expression* be = cond->binary_expression();
+  if (be == NULL)
+    return;
+  Operator op = be->op();
+  if (op == OPERATOR_EQEQ)
+    truth = !truth;
+  else if (op != OPERATOR_NOTEQ)
+    return;
+  if (!truth)
+    return;
 
-  Temporary_statement* ts = Statement::make_temporary(shortcut->type(),
-						      left, loc);
-  retblock->add_statement(ts);
+  // We now know that LEFT != RIGHT.
+  Expression* left = be->left();
+  Expression* right = be->right();
+  if (left->is_nil_expression())
+    std::swap(left, right);
+  if (!right->is_nil_expression() || left->type()->points_to() == NULL)
+    return;
+  Bce_key key = bce_key(left);
+  if (key != NULL)
+    facts->insert(key);
+}
 
-  Block* block = new Block(retblock, loc);
-  block->set_end_location(loc);
-  Expression* tmpref = Expression::make_temporary_reference(ts, loc);
-  Statement* assign = Statement::make_assignment(tmpref, right, loc);
-  block->add_statement(assign);
+// After an if statement whose branches both fall through, a value is
+// known to be non-nil if it is known to be non-nil after each branch.
 
-  Expression* cond = Expression::make_temporary_reference(ts, loc);
-  if (shortcut->binary_expression()->op() == OPERATOR_OROR)
-    cond = Expression::make_unary(OPERATOR_NOT, cond, loc);
+void
+Nil_check_function::join(Block*, const Facts& then_facts, Block*,
+			 const Facts& else_facts, Facts* flow)
+{
+  flow->clear();
+  for (Facts::const_iterator p = then_facts.begin();
+       p != then_facts.end();
+       ++p)
+    if (else_facts.find(*p) != else_facts.end())
+      flow->insert(*p);
+}
 
-  Statement* if_statement = Statement::make_if_statement(cond, block, NULL,
-							 loc);
-  retblock->add_statement(if_statement);
+// Traverse the functions in the program looking for nil checks to
+// eliminate.
 
-  *pshortcut = Expression::make_temporary_reference(ts, loc);
+class Eliminate_nil_checks : public Traverse
+{
+ public:
+  Eliminate_nil_checks(Gogo* gogo)
+    : Traverse(traverse_functions),
+      gogo_(gogo)
+  { }
 
-  delete shortcut;
+  int
+  function(Named_object*);
 
-  // Now convert any shortcut operators in LEFT and RIGHT.
-  // LEFT and RIGHT were skipped in the top level
-  // Gogo::order_evaluations. We need to order their
-  // components first.
-  Order_eval order_eval(this->gogo_);
-  retblock->traverse(&order_eval);
-  Shortcuts shortcuts(this->gogo_);
-  retblock->traverse(&shortcuts);
+ private:
+  Gogo* gogo_;
+};
 
-  return Statement::make_block_statement(retblock, loc);
+int
+Eliminate_nil_checks::function(Named_object* no)
+{
+  Nil_check_function ncf(this->gogo_);
+  Nil_check_function::Facts facts;
+  ncf.block(no->func_value()->block(), &facts);
+
+  if (this->gogo_->debug_optimization()
+      && (ncf.removed() > 0 || ncf.remaining() > 0))
+    go_inform(no->location(), "%s: %d nil checks eliminated, %d remain",
+	      no->message_name().c_str(), ncf.removed(), ncf.remaining());
+
+  return TRAVERSE_SKIP_COMPONENTS;
 }
 
-// Turn shortcut operators into explicit if statements.  Doing this
-// considerably simplifies the order of evaluation rules.
+// Remove explicit nil checks of pointers that are known to be
+// non-nil.
 
 void
-Gogo::remove_shortcuts()
+Gogo::eliminate_nil_checks()
 {
-  Shortcuts shortcuts(this);
-  this->traverse(&shortcuts);
+  if (!optimize_nilcheck_flag.is_enabled())
+    return;
+  Eliminate_nil_checks enc(this);
+  this->traverse(&enc);
 }
 
 // Traversal to flatten parse tree after order of evaluation rules are applied.
@@ -4137,6 +6513,235 @@ Gogo::flatten()
   this->traverse(&flatten);
 }
 
+// Reusing temporaries.  Ordering evaluations and flattening create a
+// temporary for nearly every subexpression with side effects, each of
+// which becomes a separate backend variable.  Within a block, a
+// temporary that is initialized after the last use of an earlier
+// temporary of the same type can share its backend variable.  A
+// temporary that is referenced outside the block that declares it,
+// or whose address is taken, is never shared, and neither is one
+// that is live across a label, since a backward goto to that label
+// would extend its live range.
+
+// The -fgo-optimize-temps flag enables this pass.
+
+Go_optimize optimize_temps_flag("temps", true);
+
+// Count references to temporary variables, and note whether there
+// are any labels.
+
+class Count_temporary_refs : public Traverse
+{
+ public:
+  typedef Unordered_map(Temporary_statement*, size_t) Counts;
+
+  Count_temporary_refs(Counts* counts)
+    : Traverse(traverse_statements | traverse_expressions),
+      counts_(counts), saw_label_(false)
+  { }
+
+  int
+  statement(Block*, size_t*, Statement*);
+
+  int
+  expression(Expression**);
+
+  bool
+  saw_label() const
+  { return this->saw_label_; }
+
+ private:
+  Counts* counts_;
+  bool saw_label_;
+};
+
+int
+Count_temporary_refs::statement(Block*, size_t*, Statement* s)
+{
+  if (s->classification() == Statement::STATEMENT_LABEL
+      || s->classification() == Statement::STATEMENT_UNNAMED_LABEL)
+    this->saw_label_ = true;
+  return TRAVERSE_CONTINUE;
+}
+
+int
+Count_temporary_refs::expression(Expression** pexpr)
+{
+  Temporary_statement* ts;
+  Temporary_reference_expression* tre =
+    (*pexpr)->temporary_reference_expression();
+  Set_and_use_temporary_expression* sut =
+    (*pexpr)->set_and_use_temporary_expression();
+  if (tre != NULL)
+    ts = tre->statement();
+  else if (sut != NULL)
+    ts = sut->temporary();
+  else
+    return TRAVERSE_CONTINUE;
+  ++(*this->counts_)[ts];
+  return TRAVERSE_CONTINUE;
+}
+
+// Look at each block in a function and reuse temporaries.
+
+class Reuse_temporaries : public Traverse
+{
+ public:
+  Reuse_temporaries(Gogo* gogo)
+    : Traverse(traverse_functions | traverse_blocks),
+      gogo_(gogo), total_refs_(), created_(0), emitted_(0)
+  { }
+
+  int
+  function(Named_object*);
+
+  int
+  block(Block*);
+
+ private:
+  // A temporary that may share its backend variable.
+  bool
+  may_share(Temporary_statement* ts) const
+  {
+    return (!ts->is_address_taken()
+	    && ts->init() != NULL
+	    && !ts->type()->is_error_type());
+  }
+
+  // General IR.
+  Gogo* gogo_;
+  // Number of references to each temporary in the current function.
+  Count_temporary_refs::Counts total_refs_;
+  // Number of temporaries seen, and number that get their own
+  // backend variable.
+  int created_;
+  int emitted_;
+};
+
+int
+Reuse_temporaries::function(Named_object* no)
+{
+  this->total_refs_.clear();
+  this->created_ = 0;
+  this->emitted_ = 0;
+
+  Function* func = no->func_value();
+  Count_temporary_refs ctr(&this->total_refs_);
+  func->block()->traverse(&ctr);
+
+  if (func->block()->traverse(this) == TRAVERSE_EXIT)
+    return TRAVERSE_EXIT;
+
+  if (this->gogo_->debug_optimization() && this->created_ > 0)
+    go_inform(no->location(), "%s: %d temporaries created, %d emitted",
+	      no->message_name().c_str(), this->created_, this->emitted_);
+
+  return TRAVERSE_SKIP_COMPONENTS;
+}
+
+int
+Reuse_temporaries::block(Block* block)
+{
+  const std::vector<Statement*>* stmts = block->statements();
+
+  // Find the index of the last statement of this block that refers
+  // to each temporary, and the number of references in this block.
+  // LABELS[I] is the number of statements before I that contain a
+  // label.
+  Unordered_map(Temporary_statement*, size_t) last_use;
+  Count_temporary_refs::Counts block_refs;
+  std::vector<size_t> labels(stmts->size() + 1);
+  for (size_t i = 0; i < stmts->size(); ++i)
+    {
+      Count_temporary_refs::Counts refs;
+      Count_temporary_refs ctr(&refs);
+      size_t index = i;
+      (*stmts)[i]->traverse(block, &index, &ctr);
+      labels[i + 1] = labels[i] + (ctr.saw_label() ? 1 : 0);
+      for (Count_temporary_refs::Counts::const_iterator p = refs.begin();
+	   p != refs.end();
+	   ++p)
+	{
+	  last_use[p->first] = i;
+	  block_refs[p->first] += p->second;
+	}
+    }
+
+  // Walk the block, handing out the backend variables of temporaries
+  // that are dead.  LIVE holds the temporary that owns the backend
+  // variable of each live temporary, with the index of its last use.
+  std::vector<std::pair<Temporary_statement*, size_t> > live;
+  std::vector<Temporary_statement*> free;
+  for (size_t i = 0; i < stmts->size(); ++i)
+    {
+      Temporary_statement* ts = (*stmts)[i]->temporary_statement();
+      if (ts != NULL)
+	{
+	  ++this->created_;
+	  bool local = (block_refs[ts] == this->total_refs_[ts]
+			&& this->may_share(ts));
+	  Temporary_statement* owner = ts;
+	  if (local)
+	    {
+	      for (std::vector<Temporary_statement*>::iterator p =
+		     free.begin();
+		   p != free.end();
+		   ++p)
+		{
+		  if (Type::are_identical((*p)->type(), ts->type(), false,
+					  NULL))
+		    {
+		      owner = *p;
+		      free.erase(p);
+		      break;
+		    }
+		}
+	    }
+	  if (owner != ts)
+	    ts->set_reuses(owner);
+	  else
+	    ++this->emitted_;
+
+	  if (local)
+	    {
+	      Unordered_map(Temporary_statement*, size_t)::const_iterator p =
+		last_use.find(ts);
+	      size_t last = p == last_use.end() ? i : p->second;
+	      if (labels[last + 1] == labels[i + 1])
+		live.push_back(std::make_pair(owner, last));
+	    }
+	}
+
+      // Variables whose last use is this statement may be reused by
+      // the next one.
+      for (size_t j = 0; j < live.size(); )
+	{
+	  if (live[j].second <= i)
+	    {
+	      free.push_back(live[j].first);
+	      live[j] = live.back();
+	      live.pop_back();
+	    }
+	  else
+	    ++j;
+	}
+    }
+
+  return TRAVERSE_CONTINUE;
+}
+
+// Share backend variables between temporaries that are not live at
+// the same time.
+
+void
+Gogo::reuse_temporaries()
+{
+  if (!optimize_temps_flag.is_enabled())
+    return;
+  Reuse_temporaries rt(this);
+  this->traverse(&rt);
+}
+
 // Traversal to convert calls to the predeclared recover function to
 // pass in an argument indicating whether it can recover from a panic
 // or not.
@@ -4498,6 +7103,44 @@ Gogo::declare_builtin_rf_address(const char* name)
   return ret;
 }
 
+// Return COND, wrapped in a call to __builtin_expect telling the
+// backend that it is probably false.  We use this for conditions that
+// guard calls to cold runtime functions, such as growslice.
+
+Expression*
+Gogo::make_unlikely(Expression* cond, Location location)
+{
+  static Named_object* builtin_expect;
+  Type* int_type = Type::lookup_integer_type("int");
+  if (builtin_expect == NULL)
+    {
+      const Location bloc = Linemap::predeclared_location();
+
+      Typed_identifier_list* param_types = new Typed_identifier_list();
+      param_types->push_back(Typed_identifier("exp", int_type, bloc));
+      param_types->push_back(Typed_identifier("c", int_type, bloc));
+
+      Typed_identifier_list* return_types = new Typed_identifier_list();
+      return_types->push_back(Typed_identifier("", int_type, bloc));
+
+      Function_type* fntype = Type::make_function_type(NULL, param_types,
+						       return_types, bloc);
+      const char* name = "__builtin_expect";
+      builtin_expect =
+	Named_object::make_function_declaration(name, NULL, fntype, bloc);
+      builtin_expect->func_declaration_value()->set_asm_name(name);
+    }
+
+  Expression* fn = Expression::make_func_reference(builtin_expect, NULL,
+						   location);
+  Expression_list* args = new Expression_list();
+  args->push_back(Expression::make_unsafe_cast(int_type, cond, location));
+  args->push_back(Expression::make_integer_ul(0, int_type, location));
+  Expression* call = Expression::make_call(fn, args, false, location);
+  Expression* zero = Expression::make_integer_ul(0, int_type, location);
+  return Expression::make_binary(OPERATOR_NOTEQ, call, zero, location);
+}
+
 // Build a call to the runtime error function.
 
 Expression*
@@ -4711,6 +7354,7 @@ Gogo::do_exports()
 		      : ""),
 		     this->imported_init_fns_,
 		     this->package_->bindings());
+  this->exported_type_descriptors_ = exp.type_descriptors();
 
   if (!this->c_header_.empty() && !saw_errors())
     this->write_c_header();
@@ -4944,7 +7588,7 @@ Function::Function(Function_type* type, Named_object* enclosing, Block* block,
   : type_(type), enclosing_(enclosing), results_(NULL),
     closure_var_(NULL), block_(block), location_(location), labels_(),
     local_type_count_(0), descriptor_(NULL), fndecl_(NULL), defer_stack_(NULL),
-    pragmas_(0), nested_functions_(0), is_sink_(false),
+    defer_records_(), pragmas_(0), nested_functions_(0), is_sink_(false),
     results_are_named_(false), is_unnamed_type_stub_method_(false),
     calls_recover_(false), is_recover_thunk_(false), has_recover_thunk_(false),
     calls_defer_retaddr_(false), is_type_specific_function_(false),
@@ -5217,6 +7861,7 @@ Function::swap_for_recover(Function *x)
   go_assert(this->location_ == x->location_);
   go_assert(this->fndecl_ == NULL && x->fndecl_ == NULL);
   go_assert(this->defer_stack_ == NULL && x->defer_stack_ == NULL);
+  go_assert(this->defer_records_.empty() && x->defer_records_.empty());
 }
 
 // Traverse the tree.
@@ -5297,6 +7942,40 @@ Function::defer_stack(Location location)
   return Expression::make_unary(OPERATOR_AND, ref, location);
 }
 
+// Return a new variable to hold a defer record in the stack frame.
+// The runtime links the record into the goroutine's defer list, so it
+// must match the _defer type in libgo/go/runtime/runtime2.go.
+
+Temporary_statement*
+Function::defer_record(Location location)
+{
+  static Type* defer_type;
+  if (defer_type == NULL)
+    {
+      Type* ptr_type = Type::make_pointer_type(Type::make_void_type());
+      Type* uintptr_type = Type::lookup_integer_type("uintptr");
+      Type* bool_type = Type::lookup_bool_type();
+      Struct_type* st =
+	Type::make_builtin_struct_type(9,
+				       "link", ptr_type,
+				       "frame", ptr_type,
+				       "panicStack", ptr_type,
+				       "_panic", ptr_type,
+				       "pfn", uintptr_type,
+				       "arg", ptr_type,
+				       "retaddr", uintptr_type,
+				       "makefunccanrecover", bool_type,
+				       "heap", bool_type);
+      defer_type = Type::make_builtin_named_type("_defer", st);
+    }
+
+  Temporary_statement* ret =
+    Statement::make_temporary(defer_type, NULL, location);
+  ret->set_is_address_taken();
+  this->defer_records_.push_back(ret);
+  return ret;
+}
+
 // Export the function.
 
 void
@@ -5836,6 +8515,14 @@ Function::build(Gogo* gogo, Named_object* named_function)
                                          var_decls);
               defer_init = this->defer_stack_->get_backend(&dcontext);
               var_decls_bstmt_list.push_back(defer_init);
+              for (std::vector<Temporary_statement*>::iterator p =
+                     this->defer_records_.begin();
+                   p != this->defer_records_.end();
+                   ++p)
+                {
+                  Bstatement* bstmt = (*p)->get_backend(&dcontext);
+                  var_decls_bstmt_list.push_back(bstmt);
+                }
               for (std::vector<Statement*>::iterator p = var_decls_stmts.begin();
                    p != var_decls_stmts.end();
                    ++p)
@@ -7757,6 +10444,39 @@ Bindings::remove_binding(Named_object* no)
   go_unreachable();
 }
 
+// Remove a list of names.  This is like calling remove_binding for
+// each one, but only walks the list of objects once.
+
+void
+Bindings::remove_bindings(const std::vector<Named_object*>& nos)
+{
+  Unordered_set(Named_object*) remove;
+  for (std::vector<Named_object*>::const_iterator p = nos.begin();
+       p != nos.end();
+       ++p)
+    {
+      Contour::iterator pb = this->bindings_.find((*p)->name());
+      go_assert(pb != this->bindings_.end() && pb->second == *p);
+      this->bindings_.erase(pb);
+      remove.insert(*p);
+    }
+
+  std::vector<Named_object*>::iterator out = this->named_objects_.begin();
+  for (std::vector<Named_object*>::iterator pn = this->named_objects_.begin();
+       pn != this->named_objects_.end();
+       ++pn)
+    {
+      if (remove.find(*pn) == remove.end())
+	{
+	  *out = *pn;
+	  ++out;
+	}
+    }
+  go_assert(static_cast<size_t>(this->named_objects_.end() - out)
+	    == remove.size());
+  this->named_objects_.erase(out, this->named_objects_.end());
+}
+
 // Add a method to the list of objects.  This is not added to the
 // lookup table.  This is so that we have a single list of objects
 // declared at the top level, which we walk through when it's time to
@@ -328,6 +328,17 @@ class Gogo
   set_debug_escape_hash(const std::string& s)
   { this->debug_escape_hash_ = s; }
 
+  // Return whether to emit optimization diagnostics.
+  bool
+  debug_optimization() const
+  { return this->debug_optimization_; }
+
+  // Set the option to emit optimization diagnostics from a command
+  // line option.
+  void
+  set_debug_optimization(bool b)
+  { this->debug_optimization_ = b; }
+
   // Return the size threshold used to determine whether to issue
   // a nil-check for a given pointer dereference. A threshold of -1
   // implies that all potentially faulting dereference ops should
@@ -342,6 +353,26 @@ class Gogo
   set_nil_check_size_threshold(int64_t bytes)
   { this->nil_check_size_threshold_ = bytes; }
 
+  // Read profile data from FILENAME, from the -fgo-profile-use
+  // option.  Return false if the file could not be read.
+  bool
+  read_profile(const char* filename);
+
+  // Return whether we have profile data.
+  bool
+  has_profile() const
+  { return !this->profile_cases_.empty() || !this->profile_calls_.empty(); }
+
+  // Return the number of times the switch case at LOC was chosen,
+  // according to the profile, or 0 if unknown.
+  uint64_t
+  profile_case_count(Location) const;
+
+  // Return the name of the dynamic type seen most often at the
+  // interface method call at LOC, according to the profile, or NULL.
+  const std::string*
+  profile_call_type(Location) const;
+
   // Import a package.  FILENAME is the file name argument, LOCAL_NAME
   // is the local name to give to the package.  If LOCAL_NAME is empty
   // the declarations are added to the global scope.
@@ -598,6 +629,14 @@ class Gogo
     this->gc_roots_.push_back(expr);
   }
 
+  // Record that a value of TYPE, or of a pointer to TYPE if
+  // IS_POINTER, is converted to the non-empty interface type ITYPE
+  // using the interface method table MTABLE, an expression that is
+  // the address of the table.
+  void
+  record_static_itab(Type* itype, Type* type, bool is_pointer,
+		     Expression* mtable);
+
   // Traverse the tree.  See the Traverse class.
   void
   traverse(Traverse*);
@@ -656,6 +695,15 @@ class Gogo
   void
   check_types_in_block(Block*);
 
+  // Call methods of interface variables with a known dynamic type
+  // directly.
+  void
+  devirtualize_calls();
+
+  // Remove unexported functions that can not be called.
+  void
+  eliminate_dead_functions();
+
   // Check for return statements.
   void
   check_return_statements();
@@ -725,10 +773,28 @@ class Gogo
   assign_with_write_barrier(Function*, Block*, Statement_inserter*,
 			    Expression* lhs, Expression* rhs, Location);
 
+  // Return an expression that is true if write barriers are enabled.
+  Expression*
+  write_barrier_enabled(Location);
+
+  // Remove array and string index bounds checks that are known to
+  // succeed.
+  void
+  eliminate_bounds_checks();
+
+  // Remove nil checks of pointers that are known to be non-nil.
+  void
+  eliminate_nil_checks();
+
   // Flatten parse tree.
   void
   flatten();
 
+  // Share backend variables between temporaries with disjoint live
+  // ranges.
+  void
+  reuse_temporaries();
+
   // Build thunks for functions which call recover.
   void
   build_recover_thunks();
@@ -738,6 +804,11 @@ class Gogo
   static Named_object*
   declare_builtin_rf_address(const char* name);
 
+  // Return an expression that is COND, with a hint to the backend
+  // that it is unlikely to be true.
+  static Expression*
+  make_unlikely(Expression* cond, Location);
+
   // Simplify statements which might use thunks: go and defer
   // statements.
   void
@@ -862,6 +933,11 @@ class Gogo
   std::string
   initializer_name();
 
+  // Return the name to use for the variable that caches the method
+  // table found at a type assertion site.
+  std::string
+  itab_cache_name();
+
   // Return the name of the variable used to represent the zero value
   // of a map.
   std::string
@@ -941,6 +1017,11 @@ class Gogo
                    std::vector<Bstatement*>&,
                    Bfunction* init_bfunction);
 
+  // Register the statically built interface method tables with the
+  // runtime.
+  void
+  register_itabs(std::vector<Bstatement*>&, Bfunction* init_bfunction);
+
   Named_object*
   write_barrier_variable();
 
@@ -962,6 +1043,21 @@ class Gogo
   typedef Unordered_map(std::string, Location) File_block_names;
 
   // Type used to queue writing a type specific function.
+  // An interface method table built statically, to register with
+  // the runtime.
+  struct Static_itab
+  {
+    Type* itype;
+    Type* type;
+    bool is_pointer;
+    Expression* mtable;
+
+    Static_itab(Type* aitype, Type* atype, bool ais_pointer,
+		Expression* amtable)
+      : itype(aitype), type(atype), is_pointer(ais_pointer), mtable(amtable)
+    { }
+  };
+
   struct Specific_type_function
   {
     Type* type;
@@ -1059,8 +1155,17 @@ class Gogo
   // -fgo-debug-escape-hash option. The analysis is run only on
   // functions with names that hash to the matching value.
   std::string debug_escape_hash_;
+  // Whether to emit optimization diagnostics, from the
+  // -fgo-debug-optimization option.
+  bool debug_optimization_;
   // Nil-check size threshhold.
   int64_t nil_check_size_threshold_;
+  // Profile counts for switch cases, from the -fgo-profile-use
+  // option, keyed by FILE:LINE.
+  Unordered_map(std::string, uint64_t) profile_cases_;
+  // The hot dynamic type at interface method calls, from the
+  // -fgo-profile-use option, keyed by FILE:LINE.
+  Unordered_map(std::string, std::string) profile_calls_;
   // A list of types to verify.
   std::vector<Type*> verify_types_;
   // A list of interface types defined while parsing.
@@ -1069,6 +1174,16 @@ class Gogo
   std::vector<Specific_type_function*> specific_type_functions_;
   // Whether we are done writing out specific type functions.
   bool specific_type_functions_are_written_;
+  // Unnamed types listed in the export data, whose type descriptors
+  // and type functions we must define.
+  std::vector<Type*> exported_type_descriptors_;
+  // Interface method tables built statically, to register with the
+  // runtime.  There is one entry for each interface type, type and
+  // pointerness.
+  std::vector<Static_itab> static_itabs_;
+  // Indexes into static_itabs_, keyed by a hash of the types, used
+  // to find an existing entry.
+  Unordered_map(unsigned int, std::vector<size_t>) static_itab_hashes_;
   // Whether named types have been converted.
   bool named_types_are_converted_;
   // A list containing groups of possibly mutually recursive functions to be
@@ -1469,6 +1584,10 @@ class Function
   Expression*
   defer_stack(Location);
 
+  // Return a new variable to hold a defer record in the stack frame.
+  Temporary_statement*
+  defer_record(Location);
+
   // Export the function.
   void
   export_func(Export*, const std::string& name) const;
@@ -1528,6 +1647,10 @@ class Function
   // distinguish the defer stack for one function from another.  This
   // is NULL unless we actually need a defer stack.
   Temporary_statement* defer_stack_;
+  // Variables holding defer records allocated in the stack frame.
+  // These are declared at the start of the function, so that they
+  // live until the deferred calls have run.
+  std::vector<Temporary_statement*> defer_records_;
   // Pragmas for this function.  This is a set of GOPRAGMA bits.
   unsigned int pragmas_;
   // Number of nested functions defined within this function.
@@ -2856,6 +2979,10 @@ class Bindings
   void
   remove_binding(Named_object*);
 
+  // Remove a list of names.
+  void
+  remove_bindings(const std::vector<Named_object*>&);
+
   // Mark all variables as used.  This is used for some types of parse
   // error.
   void
@@ -242,7 +242,8 @@ Import::find_export_data(const std::string& filename, int fd, Location location)
 
   // Check for a file containing nothing but Go export data.
   if (memcmp(buf, Export::cur_magic, Export::magic_len) == 0 ||
-      memcmp(buf, Export::v1_magic, Export::magic_len) == 0)
+      memcmp(buf, Export::v1_magic, Export::magic_len) == 0 ||
+      memcmp(buf, Export::v2_magic, Export::magic_len) == 0)
     return new Stream_from_file(fd);
 
   // See if we can read this as an archive.
@@ -325,6 +326,12 @@ Import::import(Gogo* gogo, const std::string& local_name,
 	                        Export::magic_len);
 	  this->version_ = EXPORT_FORMAT_V1;
 	}
+      else if (stream->match_bytes(Export::v2_magic, Export::magic_len))
+	{
+	  stream->require_bytes(this->location_, Export::v2_magic,
+	                        Export::magic_len);
+	  this->version_ = EXPORT_FORMAT_V2;
+	}
       else
 	{
 	  go_error_at(this->location_,
@@ -398,6 +405,9 @@ Import::import(Gogo* gogo, const std::string& local_name,
 	    this->import_var();
 	  else if (stream->match_c_string("func "))
 	    this->import_func(this->package_);
+	  else if (this->version_ >= EXPORT_FORMAT_V3
+		   && stream->match_c_string("typedescs "))
+	    this->read_type_descriptors();
 	  else if (stream->match_c_string("checksum "))
 	    break;
 	  else
@@ -424,6 +434,24 @@ Import::import(Gogo* gogo, const std::string& local_name,
   return this->package_;
 }
 
+// Read the list of unnamed types whose type descriptors are defined
+// by the package being imported.
+
+void
+Import::read_type_descriptors()
+{
+  this->require_c_string("typedescs");
+  while (!this->match_c_string(";"))
+    {
+      this->require_c_string(" ");
+      Type* type = this->read_type();
+      if (type->is_error_type())
+	return;
+      Type::record_imported_type_descriptor(type, this->package_);
+    }
+  this->require_c_string(";\n");
+}
+
 // Read a package line.  This let us reliably determine the pkgpath
 // symbol, even if the package was compiled with a -fgo-prefix option.
 
@@ -236,6 +236,10 @@ class Import
   void
   read_import_init_fns(Gogo*);
 
+  // Read the list of type descriptors defined by the package.
+  void
+  read_type_descriptors();
+
   // Import a constant.
   void
   import_const();
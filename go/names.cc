@@ -487,6 +487,20 @@ Gogo::initializer_name()
   return buf;
 }
 
+// Return the name to use for the variable that caches the method
+// table found at a type assertion site.  This is a hidden name, so the
+// variable is local to this file.
+
+std::string
+Gogo::itab_cache_name()
+{
+  static unsigned int counter;
+  char buf[30];
+  ++counter;
+  snprintf(buf, sizeof buf, "$itabcache%u", counter);
+  return this->pack_hidden_name(buf, false);
+}
+
 // Return the name of the variable used to represent the zero value of
 // a map.  This is a globally visible common symbol.
 
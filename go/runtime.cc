@@ -34,6 +34,8 @@ enum Runtime_function_type
   RFT_INT32,
   // Go type int64, C type int64_t.
   RFT_INT64,
+  // Go type uint8, C type uint8_t.
+  RFT_UINT8,
   // Go type uint64, C type uint64_t.
   RFT_UINT64,
   // Go type uintptr, C type uintptr_t.
@@ -117,6 +119,10 @@ runtime_function_type(Runtime_function_type bft)
 	  t = Type::lookup_integer_type("int64");
 	  break;
 
+	case RFT_UINT8:
+	  t = Type::lookup_integer_type("uint8");
+	  break;
+
 	case RFT_UINT64:
 	  t = Type::lookup_integer_type("uint64");
 	  break;
@@ -257,6 +263,7 @@ convert_to_runtime_function_type(Runtime_function_type bft, Expression* e,
     case RFT_INT:
     case RFT_INT32:
     case RFT_INT64:
+    case RFT_UINT8:
     case RFT_UINT64:
     case RFT_UINTPTR:
     case RFT_RUNE:
@@ -515,6 +515,20 @@ Temporary_statement::do_get_backend(Translate_context* context)
     binit = context->backend()->convert_expression(btype, binit,
                                                    this->location());
 
+  if (this->reuses_ != NULL)
+    {
+      // Share the backend variable of an earlier temporary that is
+      // dead by now.  The reuse pass only does this for a temporary
+      // with an initializer.
+      go_assert(binit != NULL);
+      this->bvariable_ = this->reuses_->get_backend_variable(context);
+      Bexpression* lhs =
+	context->backend()->var_expression(this->bvariable_,
+					   this->location());
+      return context->backend()->assignment_statement(bfunction, lhs, binit,
+						      this->location());
+    }
+
   Bstatement* statement;
   this->bvariable_ =
     context->backend()->temporary_variable(bfunction, context->bblock(),
@@ -1512,6 +1526,9 @@ class Tuple_type_guard_assignment_statement : public Statement
   void
   lower_to_object_type(Block*, Runtime::Function);
 
+  void
+  lower_to_cached_interface(Gogo*, Block*);
+
   // The variable which recieves the converted value.
   Expression* val_;
   // The variable which receives the indication of success.
@@ -1537,7 +1554,7 @@ Tuple_type_guard_assignment_statement::do_traverse(Traverse* traverse)
 // Lower to a function call.
 
 Statement*
-Tuple_type_guard_assignment_statement::do_lower(Gogo*, Named_object*,
+Tuple_type_guard_assignment_statement::do_lower(Gogo* gogo, Named_object*,
 						Block* enclosing,
 						Statement_inserter*)
 {
@@ -1568,6 +1585,11 @@ Tuple_type_guard_assignment_statement::do_lower(Gogo*, Named_object*,
 				   ? Runtime::IFACEE2E2
 				   : Runtime::IFACEI2E2),
 				  loc, 1, this->expr_);
+      else if (Expression::use_itab_cache())
+	{
+	  this->lower_to_cached_interface(gogo, b);
+	  call = NULL;
+	}
       else
 	call = this->lower_to_type(expr_is_empty
 				   ? Runtime::IFACEE2I2
@@ -1612,6 +1634,74 @@ Tuple_type_guard_assignment_statement::lower_to_type(Runtime::Function code)
 			    this->expr_);
 }
 
+// Lower a conversion to a non-empty interface type, checking the
+// method table cached at this site before calling the runtime.  The
+// interface value is built directly from the method table.
+
+void
+Tuple_type_guard_assignment_statement::lower_to_cached_interface(Gogo* gogo,
+								 Block* b)
+{
+  Location loc = this->location();
+
+  // var expr_temp = EXPR
+  Temporary_statement* expr_temp =
+    Statement::make_temporary(NULL, this->expr_, loc);
+  b->add_statement(expr_temp);
+
+  // var descriptor_temp DESCRIPTOR_TYPE = type descriptor of expr_temp
+  Expression* ref = Expression::make_temporary_reference(expr_temp, loc);
+  Expression* desc = Expression::get_interface_type_descriptor(ref);
+  Temporary_statement* descriptor_temp =
+    Statement::make_temporary(Type::make_type_descriptor_ptr_type(), desc,
+			      loc);
+  b->add_statement(descriptor_temp);
+
+  // var itab_temp = ITAB(TYPE, descriptor_temp)
+  ref = Expression::make_temporary_reference(descriptor_temp, loc);
+  Expression* itab =
+    Expression::make_cached_itab(gogo, this->type_, ref, b, loc);
+  Temporary_statement* itab_temp = Statement::make_temporary(NULL, itab, loc);
+  b->add_statement(itab_temp);
+
+  // var ok_temp = itab_temp != nil
+  ref = Expression::make_temporary_reference(itab_temp, loc);
+  Expression* cond = Expression::make_binary(OPERATOR_NOTEQ, ref,
+					     Expression::make_nil(loc), loc);
+  Temporary_statement* ok_temp = Statement::make_temporary(NULL, cond, loc);
+  b->add_statement(ok_temp);
+
+  // var val_temp TYPE
+  // if ok_temp { val_temp = TYPE{itab_temp, expr_temp.object} }
+  Temporary_statement* val_temp = Statement::make_temporary(this->type_,
+							    NULL, loc);
+  b->add_statement(val_temp);
+  Expression* first = Expression::make_temporary_reference(itab_temp, loc);
+  ref = Expression::make_temporary_reference(expr_temp, loc);
+  Expression* obj =
+    Expression::make_interface_info(ref, Expression::INTERFACE_INFO_OBJECT,
+				    loc);
+  Expression* val = Expression::make_interface_value(this->type_, first, obj,
+						     loc);
+  Block* then_block = new Block(b, loc);
+  ref = Expression::make_temporary_reference(val_temp, loc);
+  Statement* s = Statement::make_assignment(ref, val, loc);
+  then_block->add_statement(s);
+  ref = Expression::make_temporary_reference(ok_temp, loc);
+  s = Statement::make_if_statement(ref, then_block, NULL, loc);
+  b->add_statement(s);
+
+  // val = val_temp
+  ref = Expression::make_temporary_reference(val_temp, loc);
+  s = Statement::make_assignment(this->val_, ref, loc);
+  b->add_statement(s);
+
+  // ok = ok_temp
+  ref = Expression::make_temporary_reference(ok_temp, loc);
+  s = Statement::make_assignment(this->ok_, ref, loc);
+  b->add_statement(s);
+}
+
 // Lower a conversion to a non-interface non-pointer type.
 
 void
@@ -2085,13 +2175,18 @@ Thunk_statement::simplify_statement(Gogo* gogo, Named_object* function,
   if (this->call_->is_error_expression())
     return false;
 
-  if (this->classification() == STATEMENT_DEFER)
+  Defer_statement* ds = this->defer_statement();
+  if (ds != NULL)
     {
       // Make sure that the defer stack exists for the function.  We
       // will use when converting this statement to the backend
       // representation, but we want it to exist when we start
       // converting the function.
       function->func_value()->defer_stack(this->location());
+
+      // Likewise for a defer record on the stack.
+      if (ds->on_stack() && ds->record() == NULL)
+	ds->set_record(function->func_value()->defer_record(this->location()));
     }
 
   Call_expression* ce = this->call_->call_expression();
@@ -2120,10 +2215,37 @@ Thunk_statement::simplify_statement(Gogo* gogo, Named_object* function,
       fn = Expression::make_temporary_reference(fn_temp, location);
     }
 
-  std::string thunk_name = gogo->thunk_name();
+  // Go statements that call the same function with the same kinds of
+  // arguments can share a thunk.
+  std::pair<Named_object*, std::string> key;
+  bool share_thunk = (this->classification() == STATEMENT_GO
+		      && this->go_thunk_key(gogo, &key));
+  Named_object* named_thunk = NULL;
+  if (share_thunk)
+    {
+      Go_thunks::const_iterator p = Thunk_statement::go_thunks.find(key);
+      if (p != Thunk_statement::go_thunks.end())
+	{
+	  named_thunk = p->second.first;
+	  this->struct_type_ = p->second.second;
+	}
+    }
 
-  // Build the thunk.
-  this->build_thunk(gogo, thunk_name);
+  if (named_thunk == NULL)
+    {
+      std::string thunk_name = gogo->thunk_name();
+
+      // Build the thunk.
+      this->build_thunk(gogo, thunk_name);
+
+      // Look up the thunk.
+      named_thunk = gogo->lookup(thunk_name, NULL);
+      go_assert(named_thunk != NULL && named_thunk->is_function());
+
+      if (share_thunk)
+	Thunk_statement::go_thunks[key] =
+	  std::make_pair(named_thunk, this->struct_type_);
+    }
 
   // Generate code to call the thunk.
 
@@ -2154,10 +2276,32 @@ Thunk_statement::simplify_statement(Gogo* gogo, Named_object* function,
     Expression::make_struct_composite_literal(this->struct_type_, vals,
 					      location);
 
-  // Allocate the initialized struct on the heap.
-  constructor = Expression::make_heap_expression(constructor, location);
-  if ((Node::make_node(this)->encoding() & ESCAPE_MASK) == Node::ESCAPE_NONE)
-    constructor->heap_expression()->set_allocate_on_stack();
+  // If the runtime can copy the struct into the new goroutine, build
+  // it in a temporary.  Otherwise allocate the initialized struct on
+  // the heap.
+  int64_t args_size;
+  bool args_in_g = (this->classification() == STATEMENT_GO
+		    && this->go_args_fit_in_g(gogo, &args_size));
+  if (args_in_g)
+    {
+      Temporary_statement* args_temp =
+	Statement::make_temporary(this->struct_type_, constructor, location);
+      args_temp->set_is_address_taken();
+      args_temp->determine_types();
+      block->insert_statement_before(block->statements()->size() - 1,
+				     args_temp);
+      constructor = Expression::make_temporary_reference(args_temp, location);
+      constructor = Expression::make_unary(OPERATOR_AND, constructor,
+					   location);
+      constructor->unary_expression()->set_does_not_escape();
+    }
+  else
+    {
+      constructor = Expression::make_heap_expression(constructor, location);
+      if ((Node::make_node(this)->encoding() & ESCAPE_MASK)
+	  == Node::ESCAPE_NONE)
+	constructor->heap_expression()->set_allocate_on_stack();
+    }
 
   // Throw an error if the function is nil.  This is so that for `go
   // nil` we get a backtrace from the go statement, rather than a
@@ -2176,25 +2320,45 @@ Thunk_statement::simplify_statement(Gogo* gogo, Named_object* function,
       param = Expression::make_compound(crash, constructor, location);
     }
 
-  // Look up the thunk.
-  Named_object* named_thunk = gogo->lookup(thunk_name, NULL);
-  go_assert(named_thunk != NULL && named_thunk->is_function());
-
-  // Build the call.
-  Expression* func = Expression::make_func_reference(named_thunk, NULL,
-						     location);
-  Expression_list* params = new Expression_list();
-  params->push_back(param);
-  Call_expression* call = Expression::make_call(func, params, false, location);
-
   // Build the simple go or defer statement.
   Statement* s;
-  if (this->classification() == STATEMENT_GO)
-    s = Statement::make_go_statement(call, location);
-  else if (this->classification() == STATEMENT_DEFER)
-    s = Statement::make_defer_statement(call, location);
+  if (args_in_g)
+    {
+      // newprocargs(thunk, &args, sizeof args)
+      Expression* code = Expression::make_func_code_reference(named_thunk,
+							      location);
+      Type* uintptr_type = Type::lookup_integer_type("uintptr");
+      Expression* size = Expression::make_integer_int64(args_size,
+							uintptr_type,
+							location);
+      Expression* go = Runtime::make_call(Runtime::GOARGS, location, 3,
+					  code, param, size);
+      s = Statement::make_statement(go, true);
+    }
   else
-    go_unreachable();
+    {
+      // Build the call.
+      Expression* func = Expression::make_func_reference(named_thunk, NULL,
+							 location);
+      Expression_list* params = new Expression_list();
+      params->push_back(param);
+      Call_expression* call = Expression::make_call(func, params, false,
+						    location);
+
+      if (this->classification() == STATEMENT_GO)
+	s = Statement::make_go_statement(call, location);
+      else if (this->classification() == STATEMENT_DEFER)
+	{
+	  s = Statement::make_defer_statement(call, location);
+	  if (ds->on_stack())
+	    {
+	      s->defer_statement()->set_on_stack();
+	      s->defer_statement()->set_record(ds->record());
+	    }
+	}
+      else
+	go_unreachable();
+    }
 
   // The current block should end with the go statement.
   go_assert(block->statements()->size() >= 1);
@@ -2212,6 +2376,95 @@ Thunk_statement::simplify_statement(Gogo* gogo, Named_object* function,
   return true;
 }
 
+// Thunks built for go statements.
+
+Thunk_statement::Go_thunks Thunk_statement::go_thunks;
+
+// Set *KEY to the key used to share the thunk of a go statement with
+// other go statements.  The thunk depends on the function it calls,
+// unless that is passed in the struct, and on the struct type.
+// Return false if the thunk can not be shared, because constant
+// arguments are built into the thunk rather than passed in the
+// struct.
+
+bool
+Thunk_statement::go_thunk_key(Gogo* gogo,
+			      std::pair<Named_object*, std::string>* key) const
+{
+  Call_expression* ce = this->call_->call_expression();
+  if (ce->is_recover_call())
+    return false;
+  Function_type* fntype = ce->get_function_type();
+  if (fntype == NULL || fntype->is_builtin())
+    return false;
+
+  const Expression_list* args = ce->args();
+  if (args != NULL)
+    {
+      for (Expression_list::const_iterator p = args->begin();
+	   p != args->end();
+	   ++p)
+	if ((*p)->is_constant())
+	  return false;
+    }
+
+  key->first = NULL;
+  key->second = this->struct_type_->mangled_name(gogo);
+
+  Expression* fn = ce->fn();
+  if (this->is_constant_function())
+    {
+      Interface_field_reference_expression* interface_method =
+	fn->interface_field_reference_expression();
+      if (interface_method != NULL)
+	key->second += "." + interface_method->name();
+      else if (fn->func_expression() != NULL)
+	key->first = fn->func_expression()->named_object();
+      else
+	return false;
+    }
+
+  return true;
+}
+
+// The number of words of arguments that runtime.newprocargs can copy
+// into a new goroutine.  This must match goArgWords in
+// libgo/go/runtime/runtime2.go.
+
+static const int go_args_words = 4;
+
+// Return whether the struct built for a go statement can be passed
+// to runtime.newprocargs, which saves allocating it on the heap.
+// The runtime holds the copy as pointers, so every field must be
+// made of pointers.  Set *SIZE to the size of the struct.
+
+bool
+Thunk_statement::go_args_fit_in_g(Gogo* gogo, int64_t* size) const
+{
+  Type* uintptr_type = Type::lookup_integer_type("uintptr");
+  int64_t ptrsize = uintptr_type->integer_type()->bits() / 8;
+  if (!this->struct_type_->backend_type_size(gogo, size)
+      || *size > go_args_words * ptrsize)
+    return false;
+
+  const Struct_field_list* fields = this->struct_type_->fields();
+  if (fields == NULL)
+    return true;
+  for (Struct_field_list::const_iterator p = fields->begin();
+       p != fields->end();
+       ++p)
+    {
+      Type* t = p->type();
+      if (t->points_to() == NULL
+	  && t->function_type() == NULL
+	  && t->map_type() == NULL
+	  && t->channel_type() == NULL
+	  && t->interface_type() == NULL)
+	return false;
+    }
+  return true;
+}
+
 // Set the name to use for thunk parameter N.
 
 void
@@ -2595,8 +2848,19 @@ Defer_statement::do_get_backend(Translate_context* context)
   Location loc = this->location();
   Expression* ds = context->function()->func_value()->defer_stack(loc);
 
-  Expression* call = Runtime::make_call(Runtime::DEFERPROC, loc, 3,
-					ds, fn, arg);
+  Expression* call;
+  if (this->record_ == NULL)
+    call = Runtime::make_call(Runtime::DEFERPROC, loc, 3, ds, fn, arg);
+  else
+    {
+      // The defer record lives in the stack frame, so we don't need
+      // to allocate one.
+      Expression* ref = Expression::make_temporary_reference(this->record_,
+							     loc);
+      Expression* addr = Expression::make_unary(OPERATOR_AND, ref, loc);
+      call = Runtime::make_call(Runtime::DEFERPROCSTACK, loc, 4, addr, ds,
+				fn, arg);
+    }
   Bexpression* bcall = call->get_backend(context);
   Bfunction* bfunction = context->function()->func_value()->get_decl();
   return context->backend()->expression_statement(bfunction, bcall);
@@ -3502,9 +3766,16 @@ Case_clauses::is_constant() const
 // Lower case clauses for a nonconstant switch.
 
 void
-Case_clauses::lower(Block* b, Temporary_statement* val_temp,
+Case_clauses::lower(Gogo* gogo, Block* b, Temporary_statement* val_temp,
 		    Unnamed_label* break_label) const
 {
+  // If we have profile data, test the hot cases first rather than
+  // searching.
+  std::vector<size_t> order;
+  if (!this->profile_order(gogo, &order)
+      && this->lower_string_search(b, val_temp, break_label))
+    return;
+
   // The default case.
   const Case_clause* default_case = NULL;
 
@@ -3520,10 +3791,12 @@ Case_clauses::lower(Block* b, Temporary_statement* val_temp,
   // falls through.
   Unnamed_label* default_finish_label = NULL;
 
-  for (Clauses::const_iterator p = this->clauses_.begin();
-       p != this->clauses_.end();
-       ++p)
+  for (std::vector<size_t>::const_iterator po = order.begin();
+       po != order.end();
+       ++po)
     {
+      const Case_clause* p = &this->clauses_[*po];
+
       // The label to use for the start of the statements for this
       // case.  This is NULL unless the previous case falls through.
       Unnamed_label* start_label = last_fallthrough_label;
@@ -3533,7 +3806,7 @@ Case_clauses::lower(Block* b, Temporary_statement* val_temp,
       Unnamed_label* finish_label = break_label;
 
       last_fallthrough_label = NULL;
-      if (p->is_fallthrough() && p + 1 != this->clauses_.end())
+      if (p->is_fallthrough() && po + 1 != order.end())
 	{
 	  finish_label = new Unnamed_label(p->location());
 	  last_fallthrough_label = finish_label;
@@ -3545,7 +3818,7 @@ Case_clauses::lower(Block* b, Temporary_statement* val_temp,
 	{
 	  // We have to move the default case to the end, so that we
 	  // only use it if all the other tests fail.
-	  default_case = &*p;
+	  default_case = p;
 	  default_start_label = start_label;
 	  default_finish_label = finish_label;
 	}
@@ -3556,6 +3829,339 @@ Case_clauses::lower(Block* b, Temporary_statement* val_temp,
 			default_finish_label);
 }
 
+// A group of switch clauses that must stay together, used when
+// ordering clauses by profile counts.  START and END are clause
+// indexes.  A group is movable if the order in which it is tested
+// relative to its movable neighbours does not matter.
+
+struct Switch_profile_group
+{
+  size_t start;
+  size_t end;
+  uint64_t count;
+  bool movable;
+
+  Switch_profile_group(size_t s, size_t e, uint64_t c, bool m)
+    : start(s), end(e), count(c), movable(m)
+  { }
+};
+
+static bool
+switch_profile_hotter(const Switch_profile_group& a,
+		      const Switch_profile_group& b)
+{
+  return a.count > b.count;
+}
+
+// Sort each run of movable groups in GROUPS so that the ones chosen
+// most often come first, and store the resulting clause order in
+// ORDER.
+
+static void
+switch_profile_order(std::vector<Switch_profile_group>* groups,
+		     std::vector<size_t>* order)
+{
+  size_t i = 0;
+  while (i < groups->size())
+    {
+      if (!(*groups)[i].movable)
+	{
+	  ++i;
+	  continue;
+	}
+      size_t j = i + 1;
+      while (j < groups->size() && (*groups)[j].movable)
+	++j;
+      std::stable_sort(groups->begin() + i, groups->begin() + j,
+		       switch_profile_hotter);
+      i = j;
+    }
+
+  for (std::vector<Switch_profile_group>::const_iterator p = groups->begin();
+       p != groups->end();
+       ++p)
+    for (size_t k = p->start; k < p->end; ++k)
+      order->push_back(k);
+}
+
+// Set *ORDER to the order in which to test the clauses.  A clause
+// whose cases are all distinct integer or string constants, which does
+// not fall through and is not fallen into, may be tested before its
+// neighbours; with profile data the most frequently chosen such
+// clauses are tested first.  Return whether the profile changed
+// anything.
+
+bool
+Case_clauses::profile_order(Gogo* gogo, std::vector<size_t>* order) const
+{
+  std::vector<Switch_profile_group> groups;
+  std::set<std::string> keys;
+  bool hot = false;
+  bool distinct = true;
+  for (size_t i = 0; i < this->clauses_.size(); ++i)
+    {
+      const Case_clause& c(this->clauses_[i]);
+      uint64_t count = gogo->profile_case_count(c.location());
+      if (count > 0)
+	hot = true;
+
+      bool movable = (!c.is_default()
+		      && !c.is_fallthrough()
+		      && (i == 0 || !this->clauses_[i - 1].is_fallthrough())
+		      && c.cases() != NULL);
+      if (movable)
+	{
+	  for (Expression_list::const_iterator p = c.cases()->begin();
+	       p != c.cases()->end();
+	       ++p)
+	    {
+	      std::string key;
+	      Numeric_constant nc;
+	      if (!(*p)->is_constant())
+		movable = false;
+	      else if ((*p)->string_constant_value(&key))
+		key = "s" + key;
+	      else if ((*p)->numeric_constant_value(&nc) && nc.is_int())
+		{
+		  mpz_t val;
+		  nc.get_int(&val);
+		  char* str = mpz_get_str(NULL, 10, val);
+		  key = std::string("i") + str;
+		  free(str);
+		  mpz_clear(val);
+		}
+	      else
+		movable = false;
+	      if (movable && !keys.insert(key).second)
+		distinct = false;
+	    }
+	}
+      groups.push_back(Switch_profile_group(i, i + 1, count, movable));
+    }
+
+  if (!hot || !distinct)
+    {
+      for (size_t i = 0; i < this->clauses_.size(); ++i)
+	order->push_back(i);
+      return false;
+    }
+  switch_profile_order(&groups, order);
+  return true;
+}
+
+// The minimum number of distinct cases for which we lower a switch
+// on a string to a search.
+
+static const size_t string_switch_search_min_cases = 8;
+
+// The number of cases that we test one after another at the leaves of
+// a string switch search.
+
+static const size_t string_switch_search_leaf_cases = 4;
+
+// Try to lower a large switch on a string value whose cases are all
+// constants to a binary search, first on the length of the string and
+// then on the string value among cases of the same length.  The
+// statements of each clause follow the search in their original
+// order, so fallthrough still works.  Return false if this switch
+// should be lowered to a series of comparisons instead.
+
+bool
+Case_clauses::lower_string_search(Block* b, Temporary_statement* val_temp,
+				  Unnamed_label* break_label) const
+{
+  if (!val_temp->type()->is_string_type())
+    return false;
+
+  std::set<std::string> vals;
+  for (Clauses::const_iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p)
+    {
+      if (p->is_default())
+	continue;
+      if (p->cases() == NULL)
+	return false;
+      for (Expression_list::const_iterator pe = p->cases()->begin();
+	   pe != p->cases()->end();
+	   ++pe)
+	{
+	  std::string sval;
+	  if (!(*pe)->string_constant_value(&sval))
+	    return false;
+	  vals.insert(sval);
+	}
+    }
+  if (vals.size() < string_switch_search_min_cases)
+    return false;
+
+  Location loc = val_temp->location();
+
+  // Give each clause a label and collect the cases.  If the same
+  // value appears more than once, the first one wins.
+  String_cases cases;
+  std::vector<Unnamed_label*> labels;
+  labels.reserve(this->clauses_.size());
+  Unnamed_label* default_label = break_label;
+  for (Clauses::const_iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p)
+    {
+      Unnamed_label* label = new Unnamed_label(p->location());
+      labels.push_back(label);
+      if (p->is_default())
+	{
+	  default_label = label;
+	  continue;
+	}
+      for (Expression_list::const_iterator pe = p->cases()->begin();
+	   pe != p->cases()->end();
+	   ++pe)
+	{
+	  std::string sval;
+	  (*pe)->string_constant_value(&sval);
+	  cases.push_back(String_case(sval, *pe, label));
+	}
+    }
+
+  std::stable_sort(cases.begin(), cases.end());
+  String_cases unique;
+  for (String_cases::const_iterator p = cases.begin();
+       p != cases.end();
+       ++p)
+    if (unique.empty() || unique.back().val != p->val)
+      unique.push_back(*p);
+
+  // len_temp := len(val_temp)
+  Expression* ref = Expression::make_temporary_reference(val_temp, loc);
+  Expression* len =
+    Expression::make_string_info(ref, Expression::STRING_INFO_LENGTH, loc);
+  Temporary_statement* len_temp = Statement::make_temporary(NULL, len, loc);
+  b->add_statement(len_temp);
+
+  this->lower_length_search(b, len_temp, val_temp, unique, 0, unique.size(),
+			    default_label, loc);
+
+  // Now the statements for each clause, in order.
+  size_t i = 0;
+  for (Clauses::const_iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p, ++i)
+    {
+      b->add_statement(Statement::make_unnamed_label_statement(labels[i]));
+      if (p->statements() != NULL)
+	b->add_statement(Statement::make_block_statement(p->statements(),
+							 p->location()));
+      if (!p->is_fallthrough() || p + 1 == this->clauses_.end())
+	b->add_statement(Statement::make_goto_unnamed_statement(break_label,
+								p->location()));
+    }
+
+  return true;
+}
+
+// Add to B a search on the length of the string in VAL_TEMP, stored
+// in LEN_TEMP, among CASES[LO] through CASES[HI - 1].  When only one
+// length remains, search on the value.
+
+void
+Case_clauses::lower_length_search(Block* b, Temporary_statement* len_temp,
+				  Temporary_statement* val_temp,
+				  const String_cases& cases, size_t lo,
+				  size_t hi, Unnamed_label* default_label,
+				  Location loc) const
+{
+  size_t mid = lo;
+  if (cases[lo].val.length() != cases[hi - 1].val.length())
+    {
+      // Split in the middle, but keep strings of the same length
+      // together.
+      mid = lo + (hi - lo) / 2;
+      size_t l = cases[mid].val.length();
+      while (mid > lo && cases[mid - 1].val.length() == l)
+	--mid;
+      if (mid == lo)
+	{
+	  while (mid < hi && cases[mid].val.length() == l)
+	    ++mid;
+	}
+    }
+
+  if (mid == lo || mid == hi)
+    {
+      // if len_temp == LEN { search values }
+      // goto DEFAULT_LABEL
+      Expression* ref = Expression::make_temporary_reference(len_temp, loc);
+      Expression* l = Expression::make_integer_ul(cases[lo].val.length(),
+						  NULL, loc);
+      Expression* cond = Expression::make_binary(OPERATOR_EQEQ, ref, l, loc);
+      Block* then_block = new Block(b, loc);
+      this->lower_value_search(then_block, val_temp, cases, lo, hi,
+			       default_label, loc);
+      b->add_statement(Statement::make_if_statement(cond, then_block, NULL,
+						    loc));
+      b->add_statement(Statement::make_goto_unnamed_statement(default_label,
+							      loc));
+      return;
+    }
+
+  // if len_temp < LEN { search low half }
+  // search high half
+  Expression* ref = Expression::make_temporary_reference(len_temp, loc);
+  Expression* l = Expression::make_integer_ul(cases[mid].val.length(), NULL,
+					      loc);
+  Expression* cond = Expression::make_binary(OPERATOR_LT, ref, l, loc);
+  Block* then_block = new Block(b, loc);
+  this->lower_length_search(then_block, len_temp, val_temp, cases, lo, mid,
+			    default_label, loc);
+  b->add_statement(Statement::make_if_statement(cond, then_block, NULL, loc));
+  this->lower_length_search(b, len_temp, val_temp, cases, mid, hi,
+			    default_label, loc);
+}
+
+// Add to B a search for the string in VAL_TEMP among CASES[LO]
+// through CASES[HI - 1], which all have the same length and are
+// sorted.
+
+void
+Case_clauses::lower_value_search(Block* b, Temporary_statement* val_temp,
+				 const String_cases& cases, size_t lo,
+				 size_t hi, Unnamed_label* default_label,
+				 Location loc) const
+{
+  if (hi - lo <= string_switch_search_leaf_cases)
+    {
+      // if val_temp == VAL { goto LABEL }
+      for (size_t i = lo; i < hi; ++i)
+	{
+	  Expression* ref = Expression::make_temporary_reference(val_temp,
+								 loc);
+	  Expression* cond = Expression::make_binary(OPERATOR_EQEQ, ref,
+						     cases[i].expr, loc);
+	  Block* then_block = new Block(b, loc);
+	  then_block->add_statement(
+	      Statement::make_goto_unnamed_statement(cases[i].label, loc));
+	  b->add_statement(Statement::make_if_statement(cond, then_block, NULL,
+							loc));
+	}
+      b->add_statement(Statement::make_goto_unnamed_statement(default_label,
+							      loc));
+      return;
+    }
+
+  // if val_temp < VAL { search low half }
+  // search high half
+  size_t mid = lo + (hi - lo) / 2;
+  Expression* ref = Expression::make_temporary_reference(val_temp, loc);
+  Expression* v = Expression::make_string(cases[mid].val, loc);
+  Expression* cond = Expression::make_binary(OPERATOR_LT, ref, v, loc);
+  Block* then_block = new Block(b, loc);
+  this->lower_value_search(then_block, val_temp, cases, lo, mid,
+			   default_label, loc);
+  b->add_statement(Statement::make_if_statement(cond, then_block, NULL, loc));
+  this->lower_value_search(b, val_temp, cases, mid, hi, default_label, loc);
+}
+
 // Determine types.
 
 void
@@ -3779,7 +4385,7 @@ Switch_statement::do_traverse(Traverse* traverse)
 // of if statements.
 
 Statement*
-Switch_statement::do_lower(Gogo*, Named_object*, Block* enclosing,
+Switch_statement::do_lower(Gogo* gogo, Named_object*, Block* enclosing,
 			   Statement_inserter*)
 {
   Location loc = this->location();
@@ -3830,7 +4436,7 @@ Switch_statement::do_lower(Gogo*, Named_object*, Block* enclosing,
   Temporary_statement* val_temp = Statement::make_temporary(type, val, loc);
   b->add_statement(val_temp);
 
-  this->clauses_->lower(b, val_temp, this->break_label());
+  this->clauses_->lower(gogo, b, val_temp, this->break_label());
 
   Statement* s = Statement::make_unnamed_label_statement(this->break_label_);
   b->add_statement(s);
@@ -3911,6 +4517,32 @@ Type_case_clauses::Type_case_clause::traverse(Traverse* traverse)
   return TRAVERSE_CONTINUE;
 }
 
+// Report an error if the type of this clause does not implement the
+// interface type we are switching on.
+
+void
+Type_case_clauses::Type_case_clause::check_impossible(
+    Type* switch_val_type) const
+{
+  if (this->is_default_)
+    return;
+
+  Type* type = this->type_;
+  std::string reason;
+  if (switch_val_type->interface_type() != NULL
+      && !type->is_nil_constant_as_type()
+      && type->interface_type() == NULL
+      && !switch_val_type->interface_type()->implements_interface(type,
+								  &reason))
+    {
+      if (reason.empty())
+	go_error_at(this->location_, "impossible type switch case");
+      else
+	go_error_at(this->location_, "impossible type switch case (%s)",
+		    reason.c_str());
+    }
+}
+
 // Lower one clause in a type switch.  Add statements to the block B.
 // The type descriptor we are switching on is in DESCRIPTOR_TEMP.
 // BREAK_LABEL is the label at the end of the type switch.
@@ -3918,7 +4550,7 @@ Type_case_clauses::Type_case_clause::traverse(Traverse* traverse)
 // statements.
 
 void
-Type_case_clauses::Type_case_clause::lower(Type* switch_val_type,
+Type_case_clauses::Type_case_clause::lower(Gogo* gogo, Type* switch_val_type,
 					   Block* b,
 					   Temporary_statement* descriptor_temp,
 					   Unnamed_label* break_label,
@@ -3926,25 +4558,13 @@ Type_case_clauses::Type_case_clause::lower(Type* switch_val_type,
 {
   Location loc = this->location_;
 
+  this->check_impossible(switch_val_type);
+
   Unnamed_label* next_case_label = NULL;
   if (!this->is_default_)
     {
       Type* type = this->type_;
 
-      std::string reason;
-      if (switch_val_type->interface_type() != NULL
-	  && !type->is_nil_constant_as_type()
-	  && type->interface_type() == NULL
-	  && !switch_val_type->interface_type()->implements_interface(type,
-								      &reason))
-	{
-	  if (reason.empty())
-	    go_error_at(this->location_, "impossible type switch case");
-	  else
-	    go_error_at(this->location_, "impossible type switch case (%s)",
-			reason.c_str());
-	}
-
       Expression* ref = Expression::make_temporary_reference(descriptor_temp,
 							     loc);
 
@@ -3956,6 +4576,11 @@ Type_case_clauses::Type_case_clause::lower(Type* switch_val_type,
 	cond = Expression::make_binary(OPERATOR_EQEQ, ref,
 				       Expression::make_nil(loc),
 				       loc);
+      else if (type->interface_type() != NULL
+	       && !type->interface_type()->is_empty()
+	       && Expression::use_itab_cache())
+	cond = Expression::make_cached_interface_check(gogo, type, ref, b,
+						       loc);
       else
 	cond = Runtime::make_call((type->interface_type() == NULL
 				   ? Runtime::IFACETYPEEQ
@@ -4116,32 +4741,311 @@ Type_case_clauses::check_duplicates() const
 // BREAK_LABEL is the label at the end of the type switch.
 
 void
-Type_case_clauses::lower(Type* switch_val_type, Block* b,
+Type_case_clauses::lower(Gogo* gogo, Type* switch_val_type, Block* b,
 			 Temporary_statement* descriptor_temp,
 			 Unnamed_label* break_label) const
 {
+  // If we have profile data, test the hot cases first rather than
+  // searching.
+  std::vector<size_t> order;
+  if (!this->profile_order(gogo, &order)
+      && this->lower_by_hash(gogo, switch_val_type, b, descriptor_temp,
+			     break_label))
+    return;
+
   const Type_case_clause* default_case = NULL;
 
   Unnamed_label* stmts_label = NULL;
-  for (Type_clauses::const_iterator p = this->clauses_.begin();
-       p != this->clauses_.end();
-       ++p)
+  for (std::vector<size_t>::const_iterator po = order.begin();
+       po != order.end();
+       ++po)
     {
+      const Type_case_clause* p = &this->clauses_[*po];
       if (!p->is_default())
-	p->lower(switch_val_type, b, descriptor_temp, break_label,
+	p->lower(gogo, switch_val_type, b, descriptor_temp, break_label,
 		 &stmts_label);
       else
 	{
 	  // We are generating a series of tests, which means that we
 	  // need to move the default case to the end.
-	  default_case = &*p;
+	  default_case = p;
 	}
     }
   go_assert(stmts_label == NULL);
 
   if (default_case != NULL)
-    default_case->lower(switch_val_type, b, descriptor_temp, break_label,
-			NULL);
+    default_case->lower(gogo, switch_val_type, b, descriptor_temp,
+			break_label, NULL);
+}
+
+// Set *ORDER to the order in which to test the type clauses.  A
+// group of clauses for a single case that lists only non-interface
+// types may be tested before its neighbours, since a value matches at
+// most one such type; with profile data the most frequently chosen
+// groups are tested first.  Return whether the profile changed
+// anything.
+
+bool
+Type_case_clauses::profile_order(Gogo* gogo,
+				 std::vector<size_t>* order) const
+{
+  std::vector<Switch_profile_group> groups;
+  bool hot = false;
+  size_t start = 0;
+  bool movable = true;
+  uint64_t count = 0;
+  for (size_t i = 0; i < this->clauses_.size(); ++i)
+    {
+      const Type_case_clause& c(this->clauses_[i]);
+      uint64_t n = gogo->profile_case_count(c.location());
+      if (n > count)
+	count = n;
+      Type* type = c.type();
+      if (c.is_default()
+	  || type == NULL
+	  || type->interface_type() != NULL
+	  || type->is_nil_constant_as_type())
+	movable = false;
+      if (!c.is_fallthrough())
+	{
+	  if (count > 0)
+	    hot = true;
+	  groups.push_back(Switch_profile_group(start, i + 1, count, movable));
+	  start = i + 1;
+	  movable = true;
+	  count = 0;
+	}
+    }
+  if (start < this->clauses_.size())
+    groups.push_back(Switch_profile_group(start, this->clauses_.size(),
+					  count, false));
+
+  if (!hot)
+    {
+      for (size_t i = 0; i < this->clauses_.size(); ++i)
+	order->push_back(i);
+      return false;
+    }
+  switch_profile_order(&groups, order);
+  return true;
+}
+
+// The minimum number of cases for which we lower a type switch to a
+// search on the type hash code.  For fewer cases a series of
+// comparisons is just as fast.
+
+static const size_t type_switch_hash_min_cases = 8;
+
+// The number of cases that we test one after another at the leaves of
+// a type hash search.
+
+static const size_t type_switch_hash_leaf_cases = 4;
+
+// Try to lower a large type switch whose cases are all concrete types
+// to a binary search on the hash code stored in the type descriptor,
+// followed by a single type comparison.  Type descriptors for the
+// same type may appear in different shared libraries, so we can't
+// dispatch on the descriptor address, but identical types always have
+// the same hash code.  Return false if this switch should be lowered
+// to a series of comparisons instead.
+
+bool
+Type_case_clauses::lower_by_hash(Gogo* gogo, Type* switch_val_type, Block* b,
+				 Temporary_statement* descriptor_temp,
+				 Unnamed_label* break_label) const
+{
+  size_t count = 0;
+  for (Type_clauses::const_iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p)
+    {
+      if (p->is_default())
+	continue;
+      Type* type = p->type();
+      if (type->is_nil_constant_as_type()
+	  || type->is_error()
+	  || type->interface_type() != NULL)
+	return false;
+      ++count;
+    }
+  if (count < type_switch_hash_min_cases)
+    return false;
+
+  Location loc = descriptor_temp->location();
+
+  // Give each clause with statements a label, and collect the types
+  // that lead to each label.  A clause that falls through ("case T1,
+  // T2") shares the label of the next clause.
+  Hash_cases cases;
+  std::vector<Unnamed_label*> labels;
+  labels.reserve(this->clauses_.size());
+  const Type_case_clause* default_case = NULL;
+  Unnamed_label* default_label = break_label;
+  size_t pending = 0;
+  for (Type_clauses::const_iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p)
+    {
+      p->check_impossible(switch_val_type);
+      if (p->is_default())
+	{
+	  default_case = &*p;
+	  default_label = new Unnamed_label(p->location());
+	  labels.push_back(default_label);
+	  continue;
+	}
+
+      cases.push_back(Hash_case(p->type()->hash_for_method(gogo), p->type(),
+				NULL));
+      ++pending;
+      if (p->is_fallthrough())
+	{
+	  labels.push_back(NULL);
+	  continue;
+	}
+
+      Unnamed_label* label = new Unnamed_label(p->location());
+      labels.push_back(label);
+      for (size_t i = cases.size() - pending; i < cases.size(); ++i)
+	cases[i].label = label;
+      pending = 0;
+    }
+  go_assert(pending == 0);
+
+  std::stable_sort(cases.begin(), cases.end());
+
+  // var hash_temp uint32
+  // if descriptor_temp != nil { hash_temp = descriptor_temp.hash }
+  Type* uint32_type = Type::lookup_integer_type("uint32");
+  Temporary_statement* hash_temp =
+    Statement::make_temporary(uint32_type, NULL, loc);
+  b->add_statement(hash_temp);
+
+  Expression* ref = Expression::make_temporary_reference(descriptor_temp, loc);
+  Expression* cond = Expression::make_binary(OPERATOR_NOTEQ, ref,
+					     Expression::make_nil(loc), loc);
+  ref = Expression::make_temporary_reference(descriptor_temp, loc);
+  ref = Expression::make_dereference(ref, Expression::NIL_CHECK_NOT_NEEDED,
+				     loc);
+  // Field 2 of a type descriptor is the hash code.
+  Expression* hash = Expression::make_field_reference(ref, 2, loc);
+  Temporary_reference_expression* lhs =
+    Expression::make_temporary_reference(hash_temp, loc);
+  lhs->set_is_lvalue();
+  Block* then_block = new Block(b, loc);
+  then_block->add_statement(Statement::make_assignment(lhs, hash, loc));
+  b->add_statement(Statement::make_if_statement(cond, then_block, NULL, loc));
+
+  this->lower_hash_search(b, hash_temp, descriptor_temp, cases, 0,
+			  cases.size(), default_label, loc);
+
+  // Now the statements for each clause, in order.
+  size_t i = 0;
+  for (Type_clauses::const_iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p, ++i)
+    {
+      if (labels[i] == NULL || p->is_default())
+	continue;
+      b->add_statement(Statement::make_unnamed_label_statement(labels[i]));
+      Location gloc = loc;
+      if (p->statements() != NULL)
+	{
+	  b->add_statement(Statement::make_block_statement(p->statements(),
+							   p->location()));
+	  gloc = p->statements()->end_location();
+	}
+      b->add_statement(Statement::make_goto_unnamed_statement(break_label,
+							      gloc));
+    }
+
+  if (default_case != NULL)
+    {
+      b->add_statement(Statement::make_unnamed_label_statement(default_label));
+      Location gloc = default_case->location();
+      if (default_case->statements() != NULL)
+	{
+	  b->add_statement(
+	      Statement::make_block_statement(default_case->statements(),
+					      default_case->location()));
+	  gloc = default_case->statements()->end_location();
+	}
+      b->add_statement(Statement::make_goto_unnamed_statement(break_label,
+							      gloc));
+    }
+
+  return true;
+}
+
+// Add to B a search for the hash code in HASH_TEMP among CASES[LO]
+// through CASES[HI - 1], which are sorted by hash code.  On a match
+// jump to the label of the case, otherwise jump to DEFAULT_LABEL.
+
+void
+Type_case_clauses::lower_hash_search(Block* b, Temporary_statement* hash_temp,
+				     Temporary_statement* descriptor_temp,
+				     const Hash_cases& cases, size_t lo,
+				     size_t hi, Unnamed_label* default_label,
+				     Location loc) const
+{
+  // Split the range in the middle, but don't separate cases with the
+  // same hash code.
+  size_t mid = lo;
+  if (hi - lo > type_switch_hash_leaf_cases)
+    {
+      mid = lo + (hi - lo) / 2;
+      while (mid > lo && cases[mid - 1].hash == cases[mid].hash)
+	--mid;
+      if (mid == lo)
+	{
+	  mid = lo + (hi - lo) / 2;
+	  while (mid < hi && cases[mid - 1].hash == cases[mid].hash)
+	    ++mid;
+	}
+    }
+
+  if (mid == lo || mid == hi)
+    {
+      // if hash_temp == HASH && ifacetypeeq(TYPE, descriptor_temp) {
+      //   goto LABEL
+      // }
+      for (size_t i = lo; i < hi; ++i)
+	{
+	  Expression* ref = Expression::make_temporary_reference(hash_temp,
+								 loc);
+	  Expression* h = Expression::make_integer_ul(cases[i].hash,
+						      hash_temp->type(), loc);
+	  Expression* cond = Expression::make_binary(OPERATOR_EQEQ, ref, h,
+						     loc);
+	  ref = Expression::make_temporary_reference(descriptor_temp, loc);
+	  Expression* td = Expression::make_type_descriptor(cases[i].type,
+							    loc);
+	  Expression* eq = Runtime::make_call(Runtime::IFACETYPEEQ, loc, 2,
+					      td, ref);
+	  cond = Expression::make_binary(OPERATOR_ANDAND, cond, eq, loc);
+	  Block* then_block = new Block(b, loc);
+	  then_block->add_statement(
+	      Statement::make_goto_unnamed_statement(cases[i].label, loc));
+	  b->add_statement(Statement::make_if_statement(cond, then_block, NULL,
+							loc));
+	}
+      b->add_statement(Statement::make_goto_unnamed_statement(default_label,
+							      loc));
+      return;
+    }
+
+  // if hash_temp < HASH { search low half }
+  // search high half
+  Expression* ref = Expression::make_temporary_reference(hash_temp, loc);
+  Expression* h = Expression::make_integer_ul(cases[mid].hash,
+					      hash_temp->type(), loc);
+  Expression* cond = Expression::make_binary(OPERATOR_LT, ref, h, loc);
+  Block* then_block = new Block(b, loc);
+  this->lower_hash_search(then_block, hash_temp, descriptor_temp, cases, lo,
+			  mid, default_label, loc);
+  b->add_statement(Statement::make_if_statement(cond, then_block, NULL, loc));
+  this->lower_hash_search(b, hash_temp, descriptor_temp, cases, mid, hi,
+			  default_label, loc);
 }
 
 // Return true if these clauses may fall through to the statements
@@ -4192,10 +5096,11 @@ Type_switch_statement::do_traverse(Traverse* traverse)
 // compiler is able to generate a table in some cases.  However, that
 // does not work for us because we may have type descriptors in
 // different shared libraries, so we can't compare them with simple
-// equality testing.
+// equality testing.  For large switches on concrete types we search
+// on the type hash code instead; see Type_case_clauses::lower_by_hash.
 
 Statement*
-Type_switch_statement::do_lower(Gogo*, Named_object*, Block* enclosing,
+Type_switch_statement::do_lower(Gogo* gogo, Named_object*, Block* enclosing,
 				Statement_inserter*)
 {
   const Location loc = this->location();
@@ -4233,7 +5138,8 @@ Type_switch_statement::do_lower(Gogo*, Named_object*, Block* enclosing,
   b->add_statement(s);
 
   if (this->clauses_ != NULL)
-    this->clauses_->lower(val_type, b, descriptor_temp, this->break_label());
+    this->clauses_->lower(gogo, val_type, b, descriptor_temp,
+			  this->break_label());
 
   s = Statement::make_unnamed_label_statement(this->break_label_);
   b->add_statement(s);
@@ -4646,10 +5552,23 @@ Select_clauses::Select_clause::lower_recv(Gogo* gogo, Named_object* function,
 
   b->add_statement(Statement::make_statement(call, true));
 
-  // If the block of statements is executed, arrange for the received
-  // value to move from VAL to the place where the statements expect
-  // it.
+  this->set_recv_results(gogo, function, b, val, closed_temp);
+}
+
+// If the block of statements of a receive clause is executed, arrange
+// for the received value to move from VAL to the place where the
+// statements expect it, and likewise for CLOSED_TEMP.
 
+void
+Select_clauses::Select_clause::set_recv_results(
+    Gogo* gogo,
+    Named_object* function,
+    Block* b,
+    Temporary_statement* val,
+    Temporary_statement* closed_temp)
+{
+  Location loc = this->location_;
+  Expression* valref;
   Block* init = NULL;
 
   if (this->var_ != NULL)
@@ -4694,6 +5613,125 @@ Select_clauses::Select_clause::lower_recv(Gogo* gogo, Named_object* function,
     }
 }
 
+// Lower a send or receive clause of a select statement that has no
+// other non-default clauses, without building a select structure.
+// If NONBLOCKING is false there is no default clause, and we simply
+// do a blocking channel operation followed by the statements.
+// Otherwise the select statement has a default clause whose
+// statements are DEFAULT_STATEMENTS (which may be NULL), and we
+// generate
+//   if selectnbsend(c, &v) { statements } else { default_statements }
+// or the corresponding call to selectnbrecv or selectnbrecv2.
+
+void
+Select_clauses::Select_clause::lower_direct(Gogo* gogo,
+					    Named_object* function,
+					    Block* b, bool nonblocking,
+					    Block* default_statements)
+{
+  go_assert(!this->is_default_);
+  Location loc = this->location_;
+
+  Channel_type* ct = this->channel_->type()->channel_type();
+  if (ct == NULL)
+    {
+      go_assert(saw_errors());
+      this->is_lowered_ = true;
+      return;
+    }
+  Type* valtype = ct->element_type();
+
+  // Evaluate the channel before the send value, as for a full select.
+  Temporary_statement* channel_temp = Statement::make_temporary(NULL,
+								this->channel_,
+								loc);
+  b->add_statement(channel_temp);
+
+  Expression* cond = NULL;
+  if (this->is_send_)
+    {
+      Temporary_statement* val = Statement::make_temporary(valtype,
+							   this->val_, loc);
+      b->add_statement(val);
+
+      Expression* chanref = Expression::make_temporary_reference(channel_temp,
+								 loc);
+      Expression* valref = Expression::make_temporary_reference(val, loc);
+      Expression* valaddr = Expression::make_unary(OPERATOR_AND, valref, loc);
+      if (!nonblocking)
+	{
+	  Expression* call = Runtime::make_call(Runtime::CHANSEND, loc, 2,
+						chanref, valaddr);
+	  b->add_statement(Statement::make_statement(call, true));
+	}
+      else
+	cond = Runtime::make_call(Runtime::SELECTNBSEND, loc, 2, chanref,
+				  valaddr);
+    }
+  else
+    {
+      Temporary_statement* val = Statement::make_temporary(valtype, NULL, loc);
+      b->add_statement(val);
+
+      Temporary_statement* closed_temp = NULL;
+      if (this->closed_ != NULL || this->closedvar_ != NULL)
+	{
+	  closed_temp = Statement::make_temporary(Type::lookup_bool_type(),
+						  NULL, loc);
+	  b->add_statement(closed_temp);
+	}
+
+      Expression* chanref = Expression::make_temporary_reference(channel_temp,
+								 loc);
+      Expression* valref = Expression::make_temporary_reference(val, loc);
+      Expression* valaddr = Expression::make_unary(OPERATOR_AND, valref, loc);
+      if (!nonblocking)
+	{
+	  if (closed_temp == NULL)
+	    {
+	      Expression* call = Runtime::make_call(Runtime::CHANRECV1, loc, 2,
+						    chanref, valaddr);
+	      b->add_statement(Statement::make_statement(call, true));
+	    }
+	  else
+	    {
+	      Expression* call = Runtime::make_call(Runtime::CHANRECV2, loc, 2,
+						    chanref, valaddr);
+	      Temporary_reference_expression* cref =
+		Expression::make_temporary_reference(closed_temp, loc);
+	      cref->set_is_lvalue();
+	      b->add_statement(Statement::make_assignment(cref, call, loc));
+	    }
+	}
+      else if (closed_temp == NULL)
+	cond = Runtime::make_call(Runtime::SELECTNBRECV, loc, 2, valaddr,
+				  chanref);
+      else
+	{
+	  Expression* cref = Expression::make_temporary_reference(closed_temp,
+								  loc);
+	  Expression* caddr = Expression::make_unary(OPERATOR_AND, cref, loc);
+	  cond = Runtime::make_call(Runtime::SELECTNBRECV2, loc, 3, valaddr,
+				    caddr, chanref);
+	}
+
+      this->set_recv_results(gogo, function, b, val, closed_temp);
+    }
+
+  Block* statements = this->statements_;
+  if (statements == NULL)
+    statements = new Block(b, loc);
+
+  if (!nonblocking)
+    b->add_statement(Statement::make_block_statement(statements, loc));
+  else
+    b->add_statement(Statement::make_if_statement(cond, statements,
+						  default_statements, loc));
+
+  this->is_lowered_ = true;
+  this->val_ = NULL;
+}
+
 // Determine types.
 
 void
@@ -4821,6 +5859,51 @@ Select_clauses::lower(Gogo* gogo, Named_object* function, Block* b,
     p->lower(gogo, function, b, sel);
 }
 
+// Lower a select statement with a single send or receive clause,
+// optionally accompanied by a default clause, directly into channel
+// operations on the block B.  This avoids the select structure and
+// the dispatch through selectgo.  Return false if the clauses are not
+// of that form.
+
+bool
+Select_clauses::lower_direct(Gogo* gogo, Named_object* function, Block* b)
+{
+  Select_clause* clause = NULL;
+  Select_clause* default_clause = NULL;
+  for (Clauses::iterator p = this->clauses_.begin();
+       p != this->clauses_.end();
+       ++p)
+    {
+      if (p->is_default())
+	default_clause = &*p;
+      else if (clause == NULL)
+	clause = &*p;
+      else
+	return false;
+    }
+
+  if (clause == NULL)
+    {
+      // Either select {}, which blocks forever and is left to
+      // selectgo, or select { default: }, which just runs the
+      // default statements.
+      if (default_clause == NULL)
+	return false;
+      Block* statements = default_clause->statements();
+      if (statements != NULL)
+	b->add_statement(Statement::make_block_statement(statements,
+							 default_clause->location()));
+      return true;
+    }
+
+  Block* default_statements = NULL;
+  if (default_clause != NULL)
+    default_statements = default_clause->statements();
+  clause->lower_direct(gogo, function, b, default_clause != NULL,
+		       default_statements);
+  return true;
+}
+
 // Determine types.
 
 void
@@ -4970,6 +6053,22 @@ Select_statement::do_lower(Gogo* gogo, Named_object* function,
 
   go_assert(this->sel_ == NULL);
 
+  // A select with a single send or receive clause, possibly with a
+  // default, is just a channel operation.  Break statements in the
+  // clauses refer to our break label, so define it after the
+  // lowered code.
+  if (this->clauses_->lower_direct(gogo, function, b))
+    {
+      if (this->break_label_ != NULL)
+	{
+	  Statement* s =
+	    Statement::make_unnamed_label_statement(this->break_label_);
+	  b->add_statement(s);
+	}
+      this->is_lowered_ = true;
+      return Statement::make_block_statement(b, loc);
+    }
+
   int ncases = this->clauses_->size();
   Type* selstruct_type = Channel_type::select_type(ncases);
   this->sel_ = Statement::make_temporary(selstruct_type, NULL, loc);
@@ -5745,6 +6844,10 @@ For_range_statement::lower_range_string(Gogo* gogo,
   ref = this->make_range_ref(range_object, range_temp, loc);
   index_ref = Expression::make_temporary_reference(index_temp, loc);
   ref = Expression::make_string_index(ref, index_ref, NULL, loc);
+  // The loop condition keeps index_temp in bounds, unless the body
+  // can assign a shorter string to the range variable.
+  if (range_object == NULL)
+    ref->string_index_expression()->set_needs_bounds_check(false);
   ref = Expression::make_cast(rune_type, ref, loc);
   Temporary_reference_expression* value_ref =
     Expression::make_temporary_reference(value_temp, loc);
@@ -22,6 +22,7 @@ class Expression_statement;
 class Block_statement;
 class Return_statement;
 class Thunk_statement;
+class Defer_statement;
 class Goto_statement;
 class Goto_unnamed_statement;
 class Label_statement;
@@ -380,6 +381,11 @@ class Statement
   Thunk_statement*
   thunk_statement();
 
+  // If this is a defer statement, return it.  Otherwise return NULL.
+  Defer_statement*
+  defer_statement()
+  { return this->convert<Defer_statement, STATEMENT_DEFER>(); }
+
   // If this is a goto statement, return it.  Otherwise return NULL.
   Goto_statement*
   goto_statement()
@@ -612,7 +618,8 @@ class Temporary_statement : public Statement
  public:
   Temporary_statement(Type* type, Expression* init, Location location)
     : Statement(STATEMENT_TEMPORARY, location),
-      type_(type), init_(init), bvariable_(NULL), is_address_taken_(false)
+      type_(type), init_(init), bvariable_(NULL), reuses_(NULL),
+      is_address_taken_(false)
   { }
 
   // Return the type of the temporary variable.
@@ -630,6 +637,26 @@ class Temporary_statement : public Statement
   set_is_address_taken()
   { this->is_address_taken_ = true; }
 
+  // Return whether something takes the address of this temporary
+  // variable.
+  bool
+  is_address_taken() const
+  { return this->is_address_taken_; }
+
+  // Record that this temporary variable shares the backend variable
+  // of TEMP, an earlier temporary of the same type in the same block
+  // that is no longer live.  The initialization becomes an
+  // assignment.
+  void
+  set_reuses(Temporary_statement* temp)
+  { this->reuses_ = temp; }
+
+  // Return the temporary whose backend variable this one shares, or
+  // NULL.
+  Temporary_statement*
+  reuses() const
+  { return this->reuses_; }
+
   // Return the temporary variable.  This should not be called until
   // after the statement itself has been converted.
   Bvariable*
@@ -664,6 +691,8 @@ class Temporary_statement : public Statement
   Expression* init_;
   // The backend representation of the temporary variable.
   Bvariable* bvariable_;
+  // The earlier temporary whose backend variable this one shares.
+  Temporary_statement* reuses_;
   // True if something takes the address of this temporary variable.
   bool is_address_taken_;
 };
@@ -803,6 +832,11 @@ class Block_statement : public Statement
   is_lowered_for_statement()
   { return this->is_lowered_for_statement_; }
 
+  // Return the block.
+  Block*
+  block() const
+  { return this->block_; }
+
  protected:
   int
   do_traverse(Traverse* traverse)
@@ -916,6 +950,12 @@ class Select_clauses
   void
   lower(Gogo*, Named_object*, Block*, Temporary_statement*);
 
+  // Lower a select with at most one send or receive clause and an
+  // optional default clause directly into channel operations.
+  // Returns false if the clauses do not have that form.
+  bool
+  lower_direct(Gogo*, Named_object*, Block*);
+
   // Determine types.
   void
   determine_types();
@@ -966,6 +1006,12 @@ class Select_clauses
     void
     lower(Gogo*, Named_object*, Block*, Temporary_statement*);
 
+    // Lower to a direct channel operation, for a select statement
+    // with no other send or receive clauses.
+    void
+    lower_direct(Gogo*, Named_object*, Block*, bool nonblocking,
+		 Block* default_statements);
+
     // Determine types.
     void
     determine_types();
@@ -998,6 +1044,10 @@ class Select_clauses
     statements() const
     { return this->statements_; }
 
+    Block*
+    statements()
+    { return this->statements_; }
+
     // Return the location.
     Location
     location() const
@@ -1026,6 +1076,10 @@ class Select_clauses
     void
     lower_recv(Gogo*, Named_object*, Block*, Expression*, Expression*);
 
+    void
+    set_recv_results(Gogo*, Named_object*, Block*, Temporary_statement*,
+		     Temporary_statement*);
+
     // The channel.
     Expression* channel_;
     // The value to send or the lvalue to receive into.
@@ -1165,10 +1219,26 @@ class Thunk_statement : public Statement
   void
   build_thunk(Gogo*, const std::string&);
 
+  // Return the key used to share the thunk of a go statement.
+  bool
+  go_thunk_key(Gogo*, std::pair<Named_object*, std::string>*) const;
+
+  // Return whether the struct passed to the thunk of a go statement
+  // can be copied into the new goroutine by the runtime.
+  bool
+  go_args_fit_in_g(Gogo*, int64_t* size) const;
+
   // Set the name to use for thunk field N.
   void
   thunk_field_param(int n, char* buf, size_t buflen);
 
+  // Thunks built for go statements, keyed by go_thunk_key.  The
+  // value is the thunk and the struct type of its parameter.
+  typedef std::map<std::pair<Named_object*, std::string>,
+		   std::pair<Named_object*, Struct_type*> > Go_thunks;
+
+  static Go_thunks go_thunks;
+
   // The function call to be executed in a separate thread (go) or
   // later (defer).
   Expression* call_;
@@ -1200,15 +1270,44 @@ class Defer_statement : public Thunk_statement
 {
  public:
   Defer_statement(Call_expression* call, Location location)
-    : Thunk_statement(STATEMENT_DEFER, call, location)
+    : Thunk_statement(STATEMENT_DEFER, call, location),
+      on_stack_(false), record_(NULL)
   { }
 
+  // Note that this defer statement is executed at most once each time
+  // the function is called, so the defer record may be allocated in
+  // the function's stack frame.
+  void
+  set_on_stack()
+  { this->on_stack_ = true; }
+
+  // Whether the defer record may be allocated on the stack.
+  bool
+  on_stack() const
+  { return this->on_stack_; }
+
+  // The variable holding the defer record, if it is on the stack.
+  Temporary_statement*
+  record() const
+  { return this->record_; }
+
+  // Set the variable holding the defer record.
+  void
+  set_record(Temporary_statement* record)
+  { this->record_ = record; }
+
  protected:
   Bstatement*
   do_get_backend(Translate_context*);
 
   void
   do_dump_statement(Ast_dump_context*) const;
+
+ private:
+  // Whether the defer record may be allocated on the stack.
+  bool on_stack_;
+  // The variable holding the defer record when it is on the stack.
+  Temporary_statement* record_;
 };
 
 // A goto statement.
@@ -1316,6 +1415,11 @@ class Unnamed_label_statement : public Statement
  public:
   Unnamed_label_statement(Unnamed_label* label);
 
+  // Return the label itself.
+  Unnamed_label*
+  unnamed_label() const
+  { return this->label_; }
+
  protected:
   int
   do_traverse(Traverse*);
@@ -1346,6 +1450,14 @@ class If_statement : public Statement
   condition() const
   { return this->cond_; }
 
+  Block*
+  then_block() const
+  { return this->then_block_; }
+
+  Block*
+  else_block() const
+  { return this->else_block_; }
+
  protected:
   int
   do_traverse(Traverse*);
@@ -1569,7 +1681,7 @@ class Case_clauses
 
   // Lower for a nonconstant switch.
   void
-  lower(Block*, Temporary_statement*, Unnamed_label*) const;
+  lower(Gogo*, Block*, Temporary_statement*, Unnamed_label*) const;
 
   // Determine types of expressions.  The Type parameter is the type
   // of the switch value.
@@ -1608,6 +1720,49 @@ class Case_clauses
   typedef Unordered_set_hash(Expression*, Hash_integer_value,
 			     Eq_integer_value) Case_constants;
 
+  // A case in a string switch lowered to a search.
+  struct String_case
+  {
+    // The constant string value.
+    std::string val;
+    // The case expression.
+    Expression* expr;
+    // The label of the statements to execute for this case.
+    Unnamed_label* label;
+
+    String_case(const std::string& v, Expression* e, Unnamed_label* l)
+      : val(v), expr(e), label(l)
+    { }
+
+    // Order by length, then by value.
+    bool
+    operator<(const String_case& o) const
+    {
+      if (this->val.length() != o.val.length())
+	return this->val.length() < o.val.length();
+      return this->val < o.val;
+    }
+  };
+
+  typedef std::vector<String_case> String_cases;
+
+  bool
+  lower_string_search(Block*, Temporary_statement*, Unnamed_label*) const;
+
+  bool
+  profile_order(Gogo*, std::vector<size_t>*) const;
+
+  void
+  lower_length_search(Block*, Temporary_statement* len_temp,
+		      Temporary_statement* val_temp, const String_cases&,
+		      size_t lo, size_t hi, Unnamed_label* default_label,
+		      Location) const;
+
+  void
+  lower_value_search(Block*, Temporary_statement* val_temp,
+		     const String_cases&, size_t lo, size_t hi,
+		     Unnamed_label* default_label, Location) const;
+
   // One case clause.
   class Case_clause
   {
@@ -1633,6 +1788,16 @@ class Case_clauses
     is_default() const
     { return this->is_default_; }
 
+    // The list of case expressions.
+    Expression_list*
+    cases() const
+    { return this->cases_; }
+
+    // The statements to execute.
+    Block*
+    statements() const
+    { return this->statements_; }
+
     // The location of this clause.
     Location
     location() const
@@ -1782,7 +1947,7 @@ class Type_case_clauses
 
   // Lower to if and goto statements.
   void
-  lower(Type*, Block*, Temporary_statement* descriptor_temp,
+  lower(Gogo*, Type*, Block*, Temporary_statement* descriptor_temp,
 	Unnamed_label* break_label) const;
 
   // Return true if these clauses may fall through to the statements
@@ -1795,6 +1960,41 @@ class Type_case_clauses
   dump_clauses(Ast_dump_context*) const;
 
  private:
+  // A case in a type switch lowered to a search on the type hash
+  // code.
+  struct Hash_case
+  {
+    // The hash code of the type.
+    unsigned int hash;
+    // The type.
+    Type* type;
+    // The label of the statements to execute for this type.
+    Unnamed_label* label;
+
+    Hash_case(unsigned int h, Type* t, Unnamed_label* l)
+      : hash(h), type(t), label(l)
+    { }
+
+    bool
+    operator<(const Hash_case& o) const
+    { return this->hash < o.hash; }
+  };
+
+  typedef std::vector<Hash_case> Hash_cases;
+
+  bool
+  lower_by_hash(Gogo*, Type*, Block*, Temporary_statement* descriptor_temp,
+		Unnamed_label* break_label) const;
+
+  bool
+  profile_order(Gogo*, std::vector<size_t>*) const;
+
+  void
+  lower_hash_search(Block*, Temporary_statement* hash_temp,
+		    Temporary_statement* descriptor_temp,
+		    const Hash_cases&, size_t lo, size_t hi,
+		    Unnamed_label* default_label, Location) const;
+
   // One type case clause.
   class Type_case_clause
   {
@@ -1820,6 +2020,16 @@ class Type_case_clauses
     is_default() const
     { return this->is_default_; }
 
+    // Whether this falls through to the next clause.
+    bool
+    is_fallthrough() const
+    { return this->is_fallthrough_; }
+
+    // The statements to execute.
+    Block*
+    statements() const
+    { return this->statements_; }
+
     // The location of this type clause.
     Location
     location() const
@@ -1829,9 +2039,13 @@ class Type_case_clauses
     int
     traverse(Traverse*);
 
+    // Report an error if this case can never match.
+    void
+    check_impossible(Type* switch_val_type) const;
+
     // Lower to if and goto statements.
     void
-    lower(Type*, Block*, Temporary_statement* descriptor_temp,
+    lower(Gogo*, Type*, Block*, Temporary_statement* descriptor_temp,
 	  Unnamed_label* break_label, Unnamed_label** stmts_label) const;
 
     // Return true if this clause may fall through to execute the
@@ -12,6 +12,7 @@
 #include "gogo.h"
 #include "go-diagnostics.h"
 #include "go-encode-id.h"
+#include "go-optimize.h"
 #include "operator.h"
 #include "expressions.h"
 #include "statements.h"
@@ -1319,6 +1320,47 @@ Type::type_descriptor_pointer(Gogo* gogo, Location location)
 
 Type::Type_descriptor_vars Type::type_descriptor_vars;
 
+// Unnamed types whose type descriptors are defined by an imported
+// package.  A package that writes an unnamed type in its export data
+// also defines its type descriptor and type functions, and lists it
+// in the export data.  The descriptors are common symbols with names
+// that do not depend on the package, so importers may refer to them
+// instead of emitting another copy.
+
+Type::Imported_type_descriptors Type::imported_type_descriptors;
+
+// The -fgo-optimize-import-typedescs flag lets a package refer to the
+// type descriptors defined by its imports.
+
+Go_optimize optimize_import_typedescs_flag("import-typedescs", true);
+
+// Record that an imported package defines the type descriptor for T.
+
+void
+Type::record_imported_type_descriptor(const Type* t, const Package* package)
+{
+  Type::imported_type_descriptors.insert(std::make_pair(t, package));
+}
+
+// Return whether this type's descriptor should be defined by a
+// package that mentions the type in its export data.
+
+bool
+Type::should_export_type_descriptor()
+{
+  if (this->named_type() != NULL
+      || this->forward_declaration_type() != NULL
+      || this->is_error_type()
+      || this->is_abstract()
+      || this->is_void_type()
+      || this->is_nil_type()
+      || this->is_sink_type()
+      || this->is_call_multiple_result_type())
+    return false;
+  const Package* package;
+  return !this->type_descriptor_defined_elsewhere(NULL, &package);
+}
+
 // Build the type descriptor for this type.
 
 void
@@ -1459,6 +1501,19 @@ Type::type_descriptor_defined_elsewhere(Named_type* nt,
 	  *package = this->points_to()->named_type()->named_object()->package();
 	  return true;
 	}
+
+      if (optimize_import_typedescs_flag.is_enabled())
+	{
+	  Imported_type_descriptors::const_iterator p =
+	    Type::imported_type_descriptors.find(this);
+	  if (p != Type::imported_type_descriptors.end())
+	    {
+	      // An imported package promised to define this
+	      // descriptor.
+	      *package = p->second;
+	      return true;
+	    }
+	}
     }
   return false;
 }
@@ -2124,6 +2179,74 @@ Type::write_specific_type_functions(Gogo* gogo, Named_type* name, int64_t size,
   equal_fn->func_value()->descriptor(gogo, equal_fn);
 }
 
+// Return a declaration of the runtime memhash function, which hashes
+// a block of memory given its size.
+
+Named_object*
+Type::memhash_function()
+{
+  static Named_object* memhash;
+  if (memhash == NULL)
+    {
+      Location bloc = Linemap::predeclared_location();
+      Type* unsafe_pointer_type =
+	Type::make_pointer_type(Type::make_void_type());
+      Type* uintptr_type = Type::lookup_integer_type("uintptr");
+
+      Typed_identifier_list* params = new Typed_identifier_list();
+      params->push_back(Typed_identifier("key", unsafe_pointer_type, bloc));
+      params->push_back(Typed_identifier("seed", uintptr_type, bloc));
+      params->push_back(Typed_identifier("size", uintptr_type, bloc));
+
+      Typed_identifier_list* results = new Typed_identifier_list();
+      results->push_back(Typed_identifier("", uintptr_type, bloc));
+
+      Function_type* memhash_fntype = Type::make_function_type(NULL, params,
+							       results, bloc);
+
+      memhash = Named_object::make_function_declaration("runtime.memhash",
+							NULL, memhash_fntype,
+							bloc);
+      memhash->func_declaration_value()->set_asm_name("runtime.memhash");
+    }
+  return memhash;
+}
+
+// Return a declaration of the runtime memequal function, which
+// compares two blocks of memory given their size.
+
+Named_object*
+Type::memequal_function()
+{
+  static Named_object* memequal;
+  if (memequal == NULL)
+    {
+      Location bloc = Linemap::predeclared_location();
+      Type* unsafe_pointer_type =
+	Type::make_pointer_type(Type::make_void_type());
+      Type* uintptr_type = Type::lookup_integer_type("uintptr");
+
+      Typed_identifier_list* params = new Typed_identifier_list();
+      params->push_back(Typed_identifier("key1", unsafe_pointer_type, bloc));
+      params->push_back(Typed_identifier("key2", unsafe_pointer_type, bloc));
+      params->push_back(Typed_identifier("size", uintptr_type, bloc));
+
+      Typed_identifier_list* results = new Typed_identifier_list();
+      results->push_back(Typed_identifier("", Type::lookup_bool_type(),
+					  bloc));
+
+      Function_type* memequal_fntype =
+	Type::make_function_type(NULL, params, results, bloc);
+
+      memequal = Named_object::make_function_declaration("runtime.memequal",
+							 NULL,
+							 memequal_fntype,
+							 bloc);
+      memequal->func_declaration_value()->set_asm_name("runtime.memequal");
+    }
+  return memequal;
+}
+
 // Write a hash function for a type that can use an identity hash but
 // is not one of the standard supported sizes.  For example, this
 // would be used for the type [3]byte.  This builds a return statement
@@ -2136,24 +2259,8 @@ Type::write_identity_hash(Gogo* gogo, int64_t size)
 {
   Location bloc = Linemap::predeclared_location();
 
-  Type* unsafe_pointer_type = Type::make_pointer_type(Type::make_void_type());
   Type* uintptr_type = Type::lookup_integer_type("uintptr");
-
-  Typed_identifier_list* params = new Typed_identifier_list();
-  params->push_back(Typed_identifier("key", unsafe_pointer_type, bloc));
-  params->push_back(Typed_identifier("seed", uintptr_type, bloc));
-  params->push_back(Typed_identifier("size", uintptr_type, bloc));
-
-  Typed_identifier_list* results = new Typed_identifier_list();
-  results->push_back(Typed_identifier("", uintptr_type, bloc));
-
-  Function_type* memhash_fntype = Type::make_function_type(NULL, params,
-							   results, bloc);
-
-  Named_object* memhash =
-    Named_object::make_function_declaration("runtime.memhash", NULL,
-					    memhash_fntype, bloc);
-  memhash->func_declaration_value()->set_asm_name("runtime.memhash");
+  Named_object* memhash = Type::memhash_function();
 
   Named_object* key_arg = gogo->lookup("key", NULL);
   go_assert(key_arg != NULL);
@@ -2189,24 +2296,8 @@ Type::write_identity_equal(Gogo* gogo, int64_t size)
 {
   Location bloc = Linemap::predeclared_location();
 
-  Type* unsafe_pointer_type = Type::make_pointer_type(Type::make_void_type());
   Type* uintptr_type = Type::lookup_integer_type("uintptr");
-
-  Typed_identifier_list* params = new Typed_identifier_list();
-  params->push_back(Typed_identifier("key1", unsafe_pointer_type, bloc));
-  params->push_back(Typed_identifier("key2", unsafe_pointer_type, bloc));
-  params->push_back(Typed_identifier("size", uintptr_type, bloc));
-
-  Typed_identifier_list* results = new Typed_identifier_list();
-  results->push_back(Typed_identifier("", Type::lookup_bool_type(), bloc));
-
-  Function_type* memequal_fntype = Type::make_function_type(NULL, params,
-							    results, bloc);
-
-  Named_object* memequal =
-    Named_object::make_function_declaration("runtime.memequal", NULL,
-					    memequal_fntype, bloc);
-  memequal->func_declaration_value()->set_asm_name("runtime.memequal");
+  Named_object* memequal = Type::memequal_function();
 
   Named_object* key1_arg = gogo->lookup("key1", NULL);
   go_assert(key1_arg != NULL);
@@ -5919,15 +6010,74 @@ Struct_type::find_local_field(const std::string& name,
   return NULL;
 }
 
-// Return an expression for field NAME in STRUCT_EXPR, or NULL.
+// Return an expression for field NAME in STRUCT_EXPR, or NULL.  The
+// search through embedded fields is done once per name; later
+// references to the same name build the expression from the cached
+// field indexes.
 
 Field_reference_expression*
 Struct_type::field_reference(Expression* struct_expr, const std::string& name,
 			     Location location) const
 {
-  unsigned int depth;
-  return this->field_reference_depth(struct_expr, name, location, NULL,
-				     &depth);
+  if (this->field_paths_ == NULL)
+    this->field_paths_ = new Field_paths();
+
+  std::pair<Field_paths::iterator, bool> ins =
+    this->field_paths_->insert(std::make_pair(name,
+					      std::vector<unsigned int>()));
+  std::vector<unsigned int>* path = &ins.first->second;
+  if (ins.second)
+    {
+      // Search with a NULL struct expression, and record the field
+      // indexes from the innermost reference outward.
+      unsigned int depth;
+      Field_reference_expression* fre =
+	this->field_reference_depth(NULL, name, location, NULL, &depth);
+      if (fre == NULL)
+	return NULL;
+      Expression* e = fre;
+      while (e != NULL)
+	{
+	  Field_reference_expression* sub = e->field_reference_expression();
+	  go_assert(sub != NULL);
+	  path->push_back(sub->field_index());
+	  e = sub->expr();
+	  if (e != NULL)
+	    e = e->deref();
+	}
+      std::reverse(path->begin(), path->end());
+      go_assert(path->size() == depth + 1);
+    }
+
+  if (path->empty())
+    return NULL;
+
+  // Build the references from the outermost field inward.  Fields
+  // reached through an embedded field are implicit, and an embedded
+  // pointer field is dereferenced.
+  const Struct_type* st = this;
+  Expression* expr = struct_expr;
+  Field_reference_expression* ret = NULL;
+  for (size_t i = 0; i < path->size(); ++i)
+    {
+      unsigned int index = (*path)[i];
+      if (i > 0)
+	{
+	  const Struct_field* pf = st->field((*path)[i - 1]);
+	  if (pf->type()->points_to() != NULL)
+	    expr = Expression::make_dereference(ret,
+						Expression::NIL_CHECK_DEFAULT,
+						location);
+	  else
+	    expr = ret;
+	  st = pf->type()->deref()->struct_type();
+	  go_assert(st != NULL);
+	}
+      ret = Expression::make_field_reference(expr, index, location);
+      if (i > 0)
+	ret->set_implicit(true);
+    }
+  return ret;
 }
 
 // Return an expression for a field, along with the depth at which it
@@ -6333,6 +6483,46 @@ Struct_type::do_type_descriptor(Gogo* gogo, Named_type* name)
   return Expression::make_struct_composite_literal(stdt, vals, bloc);
 }
 
+// Return the number of consecutive fields, starting at field INDEX,
+// that can be hashed and compared as a single block of memory: each
+// field compares by identity and starts where the previous one ends.
+// Set *PSIZE to the combined size of those fields.
+
+unsigned int
+Struct_type::memory_field_run(Gogo* gogo, unsigned int index,
+			      int64_t* psize)
+{
+  unsigned int count = 0;
+  int64_t start = 0;
+  int64_t end = 0;
+  unsigned int field_count = this->field_count();
+  for (unsigned int i = index; i < field_count; ++i)
+    {
+      const Struct_field* pf = this->field(i);
+      if (Gogo::is_sink_name(pf->field_name()))
+	break;
+      if (!pf->type()->compare_is_identity(gogo))
+	break;
+
+      int64_t offset;
+      int64_t size;
+      if (!this->backend_field_offset(gogo, i, &offset)
+	  || !pf->type()->backend_type_size(gogo, &size))
+	break;
+      if (count == 0)
+	start = offset;
+      else if (offset != end)
+	{
+	  // There is padding before this field.
+	  break;
+	}
+      end = offset + size;
+      ++count;
+    }
+  *psize = end - start;
+  return count;
+}
+
 // Write the hash function for a struct which can not use the identity
 // function.
 
@@ -6369,32 +6559,52 @@ Struct_type::write_hash_function(Gogo* gogo, Named_type*,
   gogo->add_statement(key);
 
   // Loop over the struct fields.
-  const Struct_field_list* fields = this->fields_;
-  for (Struct_field_list::const_iterator pf = fields->begin();
-       pf != fields->end();
-       ++pf)
+  unsigned int field_count = this->field_count();
+  unsigned int field_index = 0;
+  while (field_index < field_count)
     {
+      const Struct_field* pf = this->field(field_index);
       if (Gogo::is_sink_name(pf->field_name()))
-	continue;
+	{
+	  ++field_index;
+	  continue;
+	}
 
       // Get a pointer to the value of this field.
-      Expression* offset = Expression::make_struct_field_offset(this, &*pf);
+      Expression* offset = Expression::make_struct_field_offset(this, pf);
       ref = Expression::make_temporary_reference(key, bloc);
       Expression* subkey = Expression::make_binary(OPERATOR_PLUS, ref, offset,
 						   bloc);
       subkey = Expression::make_cast(key_arg_type, subkey, bloc);
 
-      // Get the hash function to use for the type of this field.
+      // A run of adjacent fields without padding is hashed as a
+      // single block of memory.  Otherwise, get the hash function to
+      // use for the type of this field.
       Named_object* hash_fn;
-      Named_object* equal_fn;
-      pf->type()->type_functions(gogo, pf->type()->named_type(), hash_fntype,
-				 equal_fntype, &hash_fn, &equal_fn);
+      int64_t run_size;
+      unsigned int run = this->memory_field_run(gogo, field_index, &run_size);
+      if (run > 1)
+	{
+	  hash_fn = Type::memhash_function();
+	  field_index += run;
+	}
+      else
+	{
+	  Named_object* equal_fn;
+	  pf->type()->type_functions(gogo, pf->type()->named_type(),
+				     hash_fntype, equal_fntype, &hash_fn,
+				     &equal_fn);
+	  ++field_index;
+	}
 
       // Call the hash function for the field, passing retval as the seed.
       ref = Expression::make_temporary_reference(retval, bloc);
       Expression_list* args = new Expression_list();
       args->push_back(subkey);
       args->push_back(ref);
+      if (run > 1)
+	args->push_back(Expression::make_integer_int64(run_size, uintptr_type,
+						       bloc));
       Expression* func = Expression::make_func_reference(hash_fn, NULL, bloc);
       Expression* call = Expression::make_call(func, args, false, bloc);
 
@@ -6442,27 +6652,67 @@ Struct_type::write_equal_function(Gogo* gogo, Named_type* name)
   Temporary_statement* p2 = Statement::make_temporary(pt, ref, bloc);
   gogo->add_statement(p2);
 
-  const Struct_field_list* fields = this->fields_;
+  Type* uintptr_type = Type::lookup_integer_type("uintptr");
+  Type* unsafe_pointer_type = key1_arg->var_value()->type();
+
+  unsigned int field_count = this->field_count();
   unsigned int field_index = 0;
-  for (Struct_field_list::const_iterator pf = fields->begin();
-       pf != fields->end();
-       ++pf, ++field_index)
+  while (field_index < field_count)
     {
+      const Struct_field* pf = this->field(field_index);
       if (Gogo::is_sink_name(pf->field_name()))
-	continue;
+	{
+	  ++field_index;
+	  continue;
+	}
 
-      // Compare one field in both P1 and P2.
-      Expression* f1 = Expression::make_temporary_reference(p1, bloc);
-      f1 = Expression::make_dereference(f1, Expression::NIL_CHECK_DEFAULT,
-                                        bloc);
-      f1 = Expression::make_field_reference(f1, field_index, bloc);
+      Expression* cond;
+      int64_t run_size;
+      unsigned int run = this->memory_field_run(gogo, field_index, &run_size);
+      if (run > 1)
+	{
+	  // Compare a run of adjacent fields without padding in both
+	  // P1 and P2 as a single block of memory.
+	  Expression* offset = Expression::make_struct_field_offset(this, pf);
+	  Expression* k1 = Expression::make_var_reference(key1_arg, bloc);
+	  k1 = Expression::make_cast(uintptr_type, k1, bloc);
+	  k1 = Expression::make_binary(OPERATOR_PLUS, k1, offset, bloc);
+	  k1 = Expression::make_cast(unsafe_pointer_type, k1, bloc);
+
+	  offset = Expression::make_struct_field_offset(this, pf);
+	  Expression* k2 = Expression::make_var_reference(key2_arg, bloc);
+	  k2 = Expression::make_cast(uintptr_type, k2, bloc);
+	  k2 = Expression::make_binary(OPERATOR_PLUS, k2, offset, bloc);
+	  k2 = Expression::make_cast(unsafe_pointer_type, k2, bloc);
+
+	  Expression_list* args = new Expression_list();
+	  args->push_back(k1);
+	  args->push_back(k2);
+	  args->push_back(Expression::make_integer_int64(run_size,
+							 uintptr_type, bloc));
+	  Expression* func =
+	    Expression::make_func_reference(Type::memequal_function(), NULL,
+					    bloc);
+	  Expression* call = Expression::make_call(func, args, false, bloc);
+	  cond = Expression::make_unary(OPERATOR_NOT, call, bloc);
+	  field_index += run;
+	}
+      else
+	{
+	  // Compare one field in both P1 and P2.
+	  Expression* f1 = Expression::make_temporary_reference(p1, bloc);
+	  f1 = Expression::make_dereference(f1, Expression::NIL_CHECK_DEFAULT,
+					    bloc);
+	  f1 = Expression::make_field_reference(f1, field_index, bloc);
 
-      Expression* f2 = Expression::make_temporary_reference(p2, bloc);
-      f2 = Expression::make_dereference(f2, Expression::NIL_CHECK_DEFAULT,
-                                        bloc);
-      f2 = Expression::make_field_reference(f2, field_index, bloc);
+	  Expression* f2 = Expression::make_temporary_reference(p2, bloc);
+	  f2 = Expression::make_dereference(f2, Expression::NIL_CHECK_DEFAULT,
+					    bloc);
+	  f2 = Expression::make_field_reference(f2, field_index, bloc);
 
-      Expression* cond = Expression::make_binary(OPERATOR_NOTEQ, f1, f2, bloc);
+	  cond = Expression::make_binary(OPERATOR_NOTEQ, f1, f2, bloc);
+	  ++field_index;
+	}
 
       // If the values are not equal, return false.
       gogo->start_block(bloc);
@@ -11501,9 +11751,9 @@ Type::bind_field_or_method(Gogo* gogo, const Type* type, Expression* expr,
   bool found_pointer_method = false;
   std::string ambig1;
   std::string ambig2;
-  if (Type::find_field_or_method(type, name, receiver_can_be_pointer,
-				 &seen, NULL, &is_method,
-				 &found_pointer_method, &ambig1, &ambig2))
+  if (Type::lookup_field_or_method(type, name, receiver_can_be_pointer,
+				   &is_method, &found_pointer_method,
+				   &ambig1, &ambig2))
     {
       Expression* ret;
       if (!is_method)
@@ -11823,6 +12073,73 @@ Type::find_field_or_method(const Type* type,
     }
 }
 
+// Look in TYPE for a field or method named NAME, as for
+// find_field_or_method with no recursion.  The result only depends on
+// the type, the name, whether the receiver can be a pointer, and
+// whether TYPE is a pointer, so it is cached on the named or struct
+// type being searched.  Deeply embedded structs would otherwise be
+// searched again for every selector expression.
+
+bool
+Type::lookup_field_or_method(const Type* type, const std::string& name,
+			     bool receiver_can_be_pointer, bool* is_method,
+			     bool* found_pointer_method, std::string* ambig1,
+			     std::string* ambig2)
+{
+  Field_or_method_lookups* lookups = NULL;
+  const Named_type* nt = type->unalias()->named_type();
+  if (nt == NULL && type->points_to() != NULL)
+    nt = type->points_to()->unalias()->named_type();
+  if (nt != NULL)
+    lookups = nt->field_or_method_lookups();
+  else
+    {
+      const Struct_type* st = type->deref()->struct_type();
+      if (st != NULL)
+	lookups = st->field_or_method_lookups();
+    }
+
+  if (lookups == NULL)
+    {
+      std::vector<const Named_type*> seen;
+      return Type::find_field_or_method(type, name, receiver_can_be_pointer,
+					&seen, NULL, is_method,
+					found_pointer_method, ambig1, ambig2);
+    }
+
+  // The flags can't be confused with the end of a different name,
+  // since the key length determines the name length.
+  std::string key(name);
+  key.push_back(receiver_can_be_pointer ? '1' : '0');
+  key.push_back(type->points_to() != NULL ? '1' : '0');
+
+  Field_or_method_lookups::const_iterator p = lookups->find(key);
+  if (p == lookups->end())
+    {
+      Field_or_method_lookup r;
+      r.is_method = false;
+      r.found_pointer_method = false;
+      std::vector<const Named_type*> seen;
+      r.found = Type::find_field_or_method(type, name,
+					   receiver_can_be_pointer,
+					   &seen, NULL, &r.is_method,
+					   &r.found_pointer_method,
+					   &r.ambig1, &r.ambig2);
+      p = lookups->insert(std::make_pair(key, r)).first;
+    }
+
+  const Field_or_method_lookup& r(p->second);
+  *is_method = r.is_method;
+  if (r.found_pointer_method)
+    *found_pointer_method = true;
+  if (!r.ambig1.empty())
+    {
+      ambig1->assign(r.ambig1);
+      ambig2->assign(r.ambig2);
+    }
+  return r.found;
+}
+
 // Return whether NAME is an unexported field or method for TYPE.
 
 bool
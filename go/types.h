@@ -376,6 +376,27 @@ class Methods
   Method_map methods_;
 };
 
+// The result of looking up a field or method name in a type from a
+// selector expression.  These are cached on the named or struct type,
+// so that repeated selectors do not search the embedded fields again.
+
+struct Field_or_method_lookup
+{
+  // Whether the name was found, and was not ambiguous.
+  bool found;
+  // If found, whether it is a method rather than a field.
+  bool is_method;
+  // If not found, whether there is a method that could not be used
+  // because it requires a pointer receiver.
+  bool found_pointer_method;
+  // If ambiguous, paths to two of the candidates.
+  std::string ambig1;
+  std::string ambig2;
+};
+
+typedef Unordered_map(std::string, Field_or_method_lookup)
+  Field_or_method_lookups;
+
 // The base class for all types.
 
 class Type
@@ -960,6 +981,19 @@ class Type
   Bexpression*
   type_descriptor_pointer(Gogo* gogo, Location);
 
+  // Record that the type descriptor of the unnamed type T, and its
+  // hash and equality functions if it needs them, are defined by the
+  // imported package PACKAGE.
+  static void
+  record_imported_type_descriptor(const Type* t, const Package* package);
+
+  // Return whether a package that mentions this type in its export
+  // data should define the type descriptor, so that packages that
+  // import it can refer to that definition rather than building
+  // their own.
+  bool
+  should_export_type_descriptor();
+
   // Build the Garbage Collection symbol for this type.  Return a pointer to it.
   Bexpression*
   gc_symbol_pointer(Gogo* gogo);
@@ -1165,6 +1199,14 @@ class Type
   get_named_base_btype(Gogo* gogo, Type* base_type)
   { return base_type->get_btype_without_hash(gogo); }
 
+  // Return declarations of the runtime functions that hash and
+  // compare a block of memory of a given size.
+  static Named_object*
+  memhash_function();
+
+  static Named_object*
+  memequal_function();
+
  private:
   // Convert to the desired type classification, or return NULL.  This
   // is a controlled dynamic_cast.
@@ -1216,6 +1258,13 @@ class Type
   void
   make_type_descriptor_var(Gogo*);
 
+  // Map unnamed types to the imported package that defines their type
+  // descriptors.
+  typedef Unordered_map_hash(const Type*, const Package*, Type_hash_identical,
+			     Type_identical) Imported_type_descriptors;
+
+  static Imported_type_descriptors imported_type_descriptors;
+
   // Map unnamed types to type descriptor decls.
   typedef Unordered_map_hash(const Type*, Bvariable*, Type_hash_identical,
 			     Type_identical) GC_symbol_vars;
@@ -1326,6 +1375,14 @@ class Type
 		       bool* is_method, bool* found_pointer_method,
 		       std::string* ambig1, std::string* ambig2);
 
+  // Like find_field_or_method, for a selector expression, caching the
+  // result on the type.
+  static bool
+  lookup_field_or_method(const Type* type, const std::string& name,
+			 bool receiver_can_be_pointer, bool* is_method,
+			 bool* found_pointer_method, std::string* ambig1,
+			 std::string* ambig2);
+
   // Get the backend representation for a type without looking in the
   // hash table for identical types.
   Btype*
@@ -2428,7 +2485,7 @@ class Struct_type : public Type
   Struct_type(Struct_field_list* fields, Location location)
     : Type(TYPE_STRUCT),
       fields_(fields), location_(location), all_methods_(NULL),
-      is_struct_incomparable_(false)
+      lookups_(NULL), field_paths_(NULL), is_struct_incomparable_(false)
   { }
 
   // Return the field NAME.  This only looks at local fields, not at
@@ -2510,6 +2567,16 @@ class Struct_type : public Type
   Method*
   method_function(const std::string& name, bool* is_ambiguous) const;
 
+  // Return the cached results of Type::lookup_field_or_method for
+  // this type.
+  Field_or_method_lookups*
+  field_or_method_lookups() const
+  {
+    if (this->lookups_ == NULL)
+      this->lookups_ = new Field_or_method_lookups();
+    return this->lookups_;
+  }
+
   // Return a pointer to the interface method table for this type for
   // the interface INTERFACE.  If IS_POINTER is true, set the type
   // descriptor to a pointer to this type, otherwise set it to this
@@ -2616,6 +2683,10 @@ class Struct_type : public Type
   void
   write_field_to_c_header(std::ostream&, const std::string&, const Type*) const;
 
+  // Count the fields from INDEX that hash and compare as one block.
+  unsigned int
+  memory_field_run(Gogo*, unsigned int index, int64_t* psize);
+
   // Used to merge method sets of identical unnamed structs.
   typedef Unordered_map_hash(Struct_type*, Struct_type*, Type_hash_identical,
 			     Type_identical) Identical_structs;
@@ -2632,6 +2703,11 @@ class Struct_type : public Type
 
   static Struct_method_tables struct_method_tables;
 
+  // A mapping from a field name to the indexes of the fields leading
+  // to it, through embedded fields.  An empty vector means that there
+  // is no such field.
+  typedef Unordered_map(std::string, std::vector<unsigned int>) Field_paths;
+
   // Used to avoid infinite loops in field_reference_depth.
   struct Saw_named_type
   {
@@ -2650,6 +2726,10 @@ class Struct_type : public Type
   Location location_;
   // If this struct is unnamed, a list of methods.
   Methods* all_methods_;
+  // Cached results of Type::lookup_field_or_method.
+  mutable Field_or_method_lookups* lookups_;
+  // Cached results of field_reference.
+  mutable Field_paths* field_paths_;
   // True if this is a generated struct that is not considered to be
   // comparable.
   bool is_struct_incomparable_;
@@ -3241,7 +3321,7 @@ class Named_type : public Type
       named_object_(named_object), in_function_(NULL), in_function_index_(0),
       type_(type), local_methods_(NULL), all_methods_(NULL),
       interface_method_tables_(NULL), pointer_interface_method_tables_(NULL),
-      location_(location), named_btype_(NULL), dependencies_(),
+      lookups_(NULL), location_(location), named_btype_(NULL), dependencies_(),
       is_alias_(false), is_visible_(true), is_error_(false), in_heap_(true),
       is_placeholder_(false), is_converted_(false), is_verified_(false),
       seen_(false), seen_in_compare_is_identity_(false),
@@ -3409,6 +3489,16 @@ class Named_type : public Type
   bool
   is_unexported_local_method(Gogo*, const std::string& name) const;
 
+  // Return the cached results of Type::lookup_field_or_method for
+  // this type.
+  Field_or_method_lookups*
+  field_or_method_lookups() const
+  {
+    if (this->lookups_ == NULL)
+      this->lookups_ = new Field_or_method_lookups();
+    return this->lookups_;
+  }
+
   // Return a pointer to the interface method table for this type for
   // the interface INTERFACE.  If IS_POINTER is true, set the type
   // descriptor to a pointer to this type, otherwise set it to this
@@ -3519,6 +3609,8 @@ class Named_type : public Type
   // A mapping from interfaces to the associated interface method
   // tables for pointers to this type.
   Interface_method_tables* pointer_interface_method_tables_;
+  // Cached results of Type::lookup_field_or_method.
+  mutable Field_or_method_lookups* lookups_;
   // The location where this type was defined.
   Location location_;
   // The backend representation of this type during backend
@@ -73,6 +73,34 @@ Mark_address_taken::expression(Expression** pexpr)
       if ((n->encoding() & ESCAPE_MASK) == Node::ESCAPE_NONE)
         expr->heap_expression()->set_allocate_on_stack();
     }
+  Func_expression* fe = expr->func_expression();
+  if (fe != NULL
+      && fe->closure() != NULL
+      && this->gogo_->debug_escape_level() != 0)
+    {
+      // The closure itself is the heap expression handled above,
+      // which shares the escape state of the function expression.
+      Node* n = Node::make_node(expr);
+      if ((n->encoding() & ESCAPE_MASK) == Node::ESCAPE_NONE)
+        go_inform(expr->location(), "func literal closure allocated on stack");
+    }
+  Interface_field_reference_expression* ifre =
+    expr->interface_field_reference_expression();
+  if (ifre != NULL)
+    {
+      Node* n = Node::make_node(expr);
+      if ((n->encoding() & ESCAPE_MASK) == Node::ESCAPE_NONE)
+        ifre->set_allocate_on_stack();
+    }
+  Type_conversion_expression* tce = expr->conversion_expression();
+  if (tce != NULL
+      && tce->type()->interface_type() != NULL
+      && tce->expr()->type()->interface_type() == NULL)
+    {
+      Node* n = Node::make_node(expr);
+      if ((n->encoding() & ESCAPE_MASK) == Node::ESCAPE_NONE)
+        tce->set_no_escape();
+    }
   if (expr->slice_literal() != NULL)
     {
       Node* n = Node::make_node(expr);
@@ -196,6 +224,12 @@ Check_escape::expression(Expression** pexpr)
 // As far as the GC is concerned, all pointers are the same, so it
 // doesn't need the type descriptor.
 //
+// An assignment that initializes a field of an object allocated by
+// the immediately preceding statements does not need a write barrier
+// if the value stored is known not to point into the heap.  The
+// field still holds its zero value, so there is no old pointer to
+// shade, and a pointer to static data never needs to be shaded.
+//
 // There are possible optimizations that are not implemented.
 //
 // runtime.writeBarrier can only change when the goroutine is
@@ -213,7 +247,8 @@ class Write_barriers : public Traverse
  public:
   Write_barriers(Gogo* gogo)
     : Traverse(traverse_functions | traverse_variables | traverse_statements),
-      gogo_(gogo), function_(NULL), statements_added_()
+      gogo_(gogo), function_(NULL), statements_added_(),
+      fresh_block_(NULL), fresh_index_(0), fresh_temp_(NULL), fresh_var_(NULL)
   { }
 
   int
@@ -226,12 +261,32 @@ class Write_barriers : public Traverse
   statement(Block*, size_t* pindex, Statement*);
 
  private:
+  void
+  note_fresh_allocation(Block*, size_t, Statement*);
+
+  bool
+  is_fresh_initialization(Block*, size_t, Expression* lhs, Expression* rhs);
+
+  Expression*
+  batchable_store(Statement*);
+
+  bool
+  batch_assignments(Block*, size_t* pindex);
+
   // General IR.
   Gogo* gogo_;
   // Current function.
   Function* function_;
   // Statements introduced.
   Statement_inserter::Statements statements_added_;
+  // The block and index of the last statement of a sequence that
+  // allocates a new object and initializes its fields.
+  Block* fresh_block_;
+  size_t fresh_index_;
+  // The temporary or local variable that holds the newly allocated
+  // object.
+  Temporary_statement* fresh_temp_;
+  Named_object* fresh_var_;
 };
 
 // Traverse a function.  Just record it for later.
@@ -311,6 +366,279 @@ Write_barriers::variable(Named_object* no)
   return TRAVERSE_CONTINUE;
 }
 
+// If statement S at INDEX in BLOCK sets a temporary or a local stack
+// variable to a new allocation, start tracking an initialization
+// sequence for it.  Otherwise stop tracking any current sequence.
+
+void
+Write_barriers::note_fresh_allocation(Block* block, size_t index,
+				      Statement* s)
+{
+  this->fresh_block_ = NULL;
+  this->fresh_temp_ = NULL;
+  this->fresh_var_ = NULL;
+
+  Expression* init = NULL;
+  Temporary_statement* ts = s->temporary_statement();
+  Variable_declaration_statement* vds = s->variable_declaration_statement();
+  if (ts != NULL)
+    {
+      if (ts->is_address_taken())
+	return;
+      init = ts->init();
+    }
+  else if (vds != NULL)
+    {
+      Variable* var = vds->var()->var_value();
+      if (var->is_in_heap())
+	return;
+      init = var->init();
+    }
+  if (init == NULL)
+    return;
+
+  while (init->unsafe_conversion_expression() != NULL)
+    init = init->unsafe_conversion_expression()->expr();
+  if (init->allocation_expression() == NULL)
+    return;
+
+  this->fresh_block_ = block;
+  this->fresh_index_ = index;
+  if (ts != NULL)
+    this->fresh_temp_ = ts;
+  else
+    this->fresh_var_ = vds->var();
+}
+
+// Return whether the assignment LHS = RHS at INDEX in BLOCK
+// initializes a field of a newly allocated object with a value that
+// does not point into the heap, and so needs no write barrier.
+
+bool
+Write_barriers::is_fresh_initialization(Block* block, size_t index,
+					Expression* lhs, Expression* rhs)
+{
+  if (this->fresh_block_ != block || this->fresh_index_ + 1 != index)
+    return false;
+
+  // The value must be known to not point into the heap.  Require
+  // identical types so that no conversion is introduced.
+  if (!rhs->is_nil_expression())
+    {
+      if (!rhs->is_static_initializer())
+	return false;
+      if (!Type::are_identical(lhs->type(), rhs->type(), false, NULL))
+	return false;
+    }
+
+  // The destination must be a field of *P, where P holds the new
+  // object.
+  while (lhs->field_reference_expression() != NULL)
+    lhs = lhs->field_reference_expression()->expr();
+  Unary_expression* ue = lhs->unary_expression();
+  if (ue == NULL || ue->op() != OPERATOR_MULT)
+    return false;
+  Expression* ptr = ue->operand();
+  if (this->fresh_temp_ != NULL)
+    {
+      Temporary_reference_expression* tre =
+	ptr->temporary_reference_expression();
+      return tre != NULL && tre->statement() == this->fresh_temp_;
+    }
+  Var_expression* ve = ptr->var_expression();
+  return ve != NULL && ve->named_object() == this->fresh_var_;
+}
+
+// Return whether EXPR refers to a temporary or a local stack
+// variable whose address is not taken, so that its value can not be
+// changed by a store through a pointer.
+
+static bool
+is_unaliased_local(Expression* expr)
+{
+  Temporary_reference_expression* tre =
+    expr->temporary_reference_expression();
+  if (tre != NULL)
+    return !tre->statement()->is_address_taken();
+  Var_expression* ve = expr->var_expression();
+  if (ve == NULL || !ve->named_object()->is_variable())
+    return false;
+  Variable* var = ve->named_object()->var_value();
+  return !var->is_global() && !var->is_in_heap() && !var->is_address_taken();
+}
+
+// Return whether A and B refer to the same temporary or variable.
+
+static bool
+same_local(Expression* a, Expression* b)
+{
+  Temporary_reference_expression* atre = a->temporary_reference_expression();
+  Temporary_reference_expression* btre = b->temporary_reference_expression();
+  if (atre != NULL || btre != NULL)
+    return (atre != NULL
+	    && btre != NULL
+	    && atre->statement() == btre->statement());
+  return (a->var_expression()->named_object()
+	  == b->var_expression()->named_object());
+}
+
+// If S is an assignment that stores a single pointer into a field of
+// *P, where P is an unaliased local, and the stored value needs no
+// evaluation, return P.  Such stores may be grouped so that their
+// write barriers are done by a single runtime call.  Otherwise return
+// NULL.
+
+Expression*
+Write_barriers::batchable_store(Statement* s)
+{
+  if (this->statements_added_.find(s) != this->statements_added_.end())
+    return NULL;
+  Assignment_statement* as = s->assignment_statement();
+  if (as == NULL)
+    return NULL;
+  Expression* lhs = as->lhs();
+  Expression* rhs = as->rhs();
+  if (!this->gogo_->assign_needs_write_barrier(lhs))
+    return NULL;
+
+  switch (lhs->type()->base()->classification())
+    {
+    case Type::TYPE_POINTER:
+    case Type::TYPE_FUNCTION:
+    case Type::TYPE_MAP:
+    case Type::TYPE_CHANNEL:
+      break;
+    default:
+      return NULL;
+    }
+
+  if (!rhs->is_nil_expression())
+    {
+      if (!Type::are_identical(lhs->type(), rhs->type(), false, NULL))
+	return NULL;
+      if (!rhs->is_static_initializer() && !is_unaliased_local(rhs))
+	return NULL;
+    }
+
+  while (lhs->field_reference_expression() != NULL)
+    lhs = lhs->field_reference_expression()->expr();
+  Unary_expression* ue = lhs->unary_expression();
+  if (ue == NULL || ue->op() != OPERATOR_MULT)
+    return NULL;
+  if (!is_unaliased_local(ue->operand()))
+    return NULL;
+  return ue->operand();
+}
+
+// If the statement at *PINDEX in BLOCK starts a run of pointer stores
+// through the same local pointer, replace the run with a single test
+// of whether write barriers are enabled.  If they are, pass all the
+// stores to one runtime call; if not, do plain stores.  Returns
+// whether the statements were replaced.
+
+bool
+Write_barriers::batch_assignments(Block* block, size_t* pindex)
+{
+  if (this->function_ != NULL
+      && ((this->function_->pragmas() & GOPRAGMA_NOWRITEBARRIER) != 0
+	  || (this->function_->pragmas() & GOPRAGMA_NOWRITEBARRIERREC) != 0))
+    return false;
+
+  const std::vector<Statement*>* stmts = block->statements();
+  Expression* base = this->batchable_store((*stmts)[*pindex]);
+  if (base == NULL)
+    return false;
+  std::vector<Assignment_statement*> run;
+  run.push_back((*stmts)[*pindex]->assignment_statement());
+  for (size_t i = *pindex + 1; i < stmts->size(); ++i)
+    {
+      Expression* b = this->batchable_store((*stmts)[i]);
+      if (b == NULL || !same_local(base, b))
+	break;
+      run.push_back((*stmts)[i]->assignment_statement());
+    }
+  if (run.size() < 2)
+    return false;
+
+  Location loc = run[0]->location();
+  Statement_inserter inserter(block, pindex, &this->statements_added_);
+  Type* unsafe_ptr_type = Type::make_pointer_type(Type::make_void_type());
+  Expression_list* pairs = new Expression_list();
+  Block* else_block = new Block(block, loc);
+  for (std::vector<Assignment_statement*>::const_iterator p = run.begin();
+       p != run.end();
+       ++p)
+    {
+      Location sloc = (*p)->location();
+      Expression* addr = Expression::make_unary(OPERATOR_AND, (*p)->lhs(),
+						sloc);
+      addr->unary_expression()->set_does_not_escape();
+      Temporary_statement* addr_temp = Statement::make_temporary(NULL, addr,
+								 sloc);
+      inserter.insert(addr_temp);
+
+      Expression* ref = Expression::make_temporary_reference(addr_temp, sloc);
+      pairs->push_back(Expression::make_unsafe_cast(unsafe_ptr_type, ref,
+						    sloc));
+      Expression* rhs = (*p)->rhs();
+      if (rhs->is_nil_expression())
+	pairs->push_back(Expression::make_cast(unsafe_ptr_type, rhs->copy(),
+					       sloc));
+      else
+	pairs->push_back(Expression::make_unsafe_cast(unsafe_ptr_type,
+						      rhs->copy(), sloc));
+
+      ref = Expression::make_temporary_reference(addr_temp, sloc);
+      Expression* indir =
+	Expression::make_dereference(ref, Expression::NIL_CHECK_DEFAULT, sloc);
+      else_block->add_statement(Statement::make_assignment(indir, rhs, sloc));
+    }
+
+  // Build the array of (dst, src) pairs on the stack and pass it to
+  // the runtime.
+  Block* then_block = new Block(block, loc);
+  Expression* len = Expression::make_integer_ul(pairs->size(), NULL, loc);
+  Array_type* pairs_type = Type::make_array_type(unsafe_ptr_type, len);
+  pairs_type->set_is_array_incomparable();
+  Expression* pairs_val =
+    Expression::make_array_composite_literal(pairs_type, pairs, loc);
+  Temporary_statement* pairs_temp = Statement::make_temporary(NULL, pairs_val,
+							      loc);
+  pairs_temp->set_is_address_taken();
+  then_block->add_statement(pairs_temp);
+
+  Expression* ref = Expression::make_temporary_reference(pairs_temp, loc);
+  Expression* addr = Expression::make_unary(OPERATOR_AND, ref, loc);
+  addr->unary_expression()->set_does_not_escape();
+  addr = Expression::make_unsafe_cast(unsafe_ptr_type, addr, loc);
+  Type* uintptr_type = Type::lookup_integer_type("uintptr");
+  Expression* count = Expression::make_integer_ul(run.size(), uintptr_type,
+						  loc);
+  Expression* call = Runtime::make_call(Runtime::WRITEBARRIERPTRS, loc, 2,
+					addr, count);
+  then_block->add_statement(Statement::make_statement(call, false));
+
+  Expression* cond = this->gogo_->write_barrier_enabled(loc);
+  Statement* ifs = Statement::make_if_statement(cond, then_block, else_block,
+						loc);
+  this->statements_added_.insert(ifs);
+  block->replace_statement(*pindex, ifs);
+
+  // The remaining statements of the run are now empty.
+  for (size_t i = 1; i < run.size(); ++i)
+    {
+      Statement* empty =
+	Statement::make_block_statement(new Block(block, loc), loc);
+      this->statements_added_.insert(empty);
+      block->replace_statement(*pindex + i, empty);
+    }
+
+  if (this->gogo_->debug_optimization())
+    go_inform(loc, "%d write barriers batched", static_cast<int>(run.size()));
+
+  return true;
+}
+
 // Insert write barriers for statements.
 
 int
@@ -319,6 +647,18 @@ Write_barriers::statement(Block* block, size_t* pindex, Statement* s)
   if (this->statements_added_.find(s) != this->statements_added_.end())
     return TRAVERSE_SKIP_COMPONENTS;
 
+  // Continue an initialization sequence for a new object if this
+  // statement stores a value that needs no write barrier.
+  Assignment_statement* fresh_as = s->assignment_statement();
+  if (fresh_as != NULL
+      && this->is_fresh_initialization(block, *pindex, fresh_as->lhs(),
+				       fresh_as->rhs()))
+    {
+      this->fresh_index_ = *pindex;
+      return TRAVERSE_CONTINUE;
+    }
+  this->note_fresh_allocation(block, *pindex, s);
+
   switch (s->classification())
     {
     default:
@@ -395,6 +735,10 @@ Write_barriers::statement(Block* block, size_t* pindex, Statement* s)
 	if (!this->gogo_->assign_needs_write_barrier(lhs))
 	  break;
 
+	// Handle a run of simple pointer stores together.
+	if (this->batch_assignments(block, pindex))
+	  break;
+
 	// Change the assignment to use a write barrier.
 	Function* function = this->function_;
 	Location loc = as->location();
@@ -640,6 +984,17 @@ Gogo::assign_with_write_barrier(Function* function, Block* enclosing,
 				   Statement::make_statement(call, false));
 }
 
+// Return an expression that is true if write barriers are enabled.
+
+Expression*
+Gogo::write_barrier_enabled(Location loc)
+{
+  Named_object* wb = this->write_barrier_variable();
+  Expression* ref = Expression::make_var_reference(wb, loc);
+  Expression* zero = Expression::make_integer_ul(0, ref->type(), loc);
+  return Expression::make_binary(OPERATOR_NOTEQ, ref, zero, loc);
+}
+
 // Return a statement that tests whether write barriers are enabled
 // and executes either the efficient code or the write barrier
 // function call, depending.
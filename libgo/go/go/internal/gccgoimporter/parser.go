@@ -763,7 +763,7 @@ func (p *parser) maybeCreatePackage() {
 	}
 }
 
-// InitDataDirective = ( "v1" | "v2" ) ";" |
+// InitDataDirective = ( "v1" | "v2" | "v3" ) ";" |
 //                     "priority" int ";" |
 //                     "init" { PackageInit } ";" |
 //                     "checksum" unquotedString ";" .
@@ -774,7 +774,7 @@ func (p *parser) parseInitDataDirective() {
 	}
 
 	switch p.lit {
-	case "v1", "v2":
+	case "v1", "v2", "v3":
 		p.version = p.lit
 		p.next()
 		p.expect(';')
@@ -823,7 +823,8 @@ func (p *parser) parseInitDataDirective() {
 //             "func" Func ";" |
 //             "type" Type ";" |
 //             "var" Var ";" |
-//             "const" Const ";" .
+//             "const" Const ";" |
+//             "typedescs" { Type } ";" .
 func (p *parser) parseDirective() {
 	if p.tok != scanner.Ident {
 		// unexpected token kind; panic
@@ -831,14 +832,14 @@ func (p *parser) parseDirective() {
 	}
 
 	switch p.lit {
-	case "v1", "v2", "priority", "init", "init_graph", "checksum":
+	case "v1", "v2", "v3", "priority", "init", "init_graph", "checksum":
 		p.parseInitDataDirective()
 
 	case "package":
 		p.next()
 		p.pkgname = p.parseUnquotedString()
 		p.maybeCreatePackage()
-		if p.version == "v2" && p.tok != ';' {
+		if p.version != "v1" && p.tok != ';' {
 			p.parseUnquotedString()
 			p.parseUnquotedString()
 		}
@@ -888,6 +889,15 @@ func (p *parser) parseDirective() {
 		p.pkg.Scope().Insert(c)
 		p.expect(';')
 
+	case "typedescs":
+		// The list of type descriptors defined by the package
+		// is only of interest to the compiler.
+		p.next()
+		for p.tok != ';' && p.tok != scanner.EOF {
+			p.parseType(p.pkg)
+		}
+		p.expect(';')
+
 	default:
 		p.errorf("unexpected identifier: %q", p.lit)
 	}
@@ -144,6 +144,49 @@ func BenchmarkAppendStr(b *testing.B) {
 	}
 }
 
+func BenchmarkAppendMultiple(b *testing.B) {
+	b.Run("Int", func(b *testing.B) {
+		x := make([]int, 0, 3*N)
+		for i := 0; i < b.N; i++ {
+			x = x[0:0]
+			for j := 0; j < N; j++ {
+				x = append(x, j, j+1, j+2)
+			}
+		}
+	})
+	b.Run("Ptr", func(b *testing.B) {
+		var p byte
+		x := make([]*byte, 0, 3*N)
+		for i := 0; i < b.N; i++ {
+			x = x[0:0]
+			for j := 0; j < N; j++ {
+				x = append(x, &p, &p, &p)
+			}
+		}
+	})
+}
+
+func BenchmarkAppendSliceElem(b *testing.B) {
+	for _, length := range []int{1, 4, 16} {
+		b.Run(fmt.Sprint(length, "Int"), func(b *testing.B) {
+			x := make([]int, 0, N)
+			y := make([]int, length)
+			for i := 0; i < b.N; i++ {
+				x = x[0:0]
+				x = append(x, y...)
+			}
+		})
+		b.Run(fmt.Sprint(length, "Ptr"), func(b *testing.B) {
+			x := make([]*byte, 0, N)
+			y := make([]*byte, length)
+			for i := 0; i < b.N; i++ {
+				x = x[0:0]
+				x = append(x, y...)
+			}
+		})
+	}
+}
+
 func BenchmarkAppendSpecialCase(b *testing.B) {
 	b.StopTimer()
 	x := make([]int, 0, N)
@@ -642,3 +642,51 @@ func BenchmarkBulkWriteBarrier(b *testing.B) {
 
 	runtime.KeepAlive(ptrs)
 }
+
+// Stress defer records on the stack, linked to and from records in the
+// heap, while the garbage collector runs.
+func TestStackDeferGC(t *testing.T) {
+	defer debug.SetGCPercent(debug.SetGCPercent(1))
+
+	const goroutines = 8
+	done := make(chan int, goroutines)
+	for g := 0; g < goroutines; g++ {
+		go func() {
+			sum := 0
+			for i := 0; i < 1000; i++ {
+				sum += stackDeferOuter(i)
+			}
+			done <- sum
+		}()
+	}
+	want := 0
+	for i := 0; i < 1000; i++ {
+		want += 3*i + 3
+	}
+	for g := 0; g < goroutines; g++ {
+		if got := <-done; got != want {
+			t.Errorf("got %d, want %d", got, want)
+		}
+	}
+}
+
+var stackDeferSink []byte
+
+// stackDeferOuter runs a heap allocated defer, from the loop, around a
+// call that runs a stack allocated defer.
+func stackDeferOuter(i int) (r int) {
+	for j := 0; j < 1; j++ {
+		defer func(p *int) { r += *p + 1 }(&i)
+	}
+	return stackDeferInner(i)
+}
+
+func stackDeferInner(i int) (r int) {
+	defer func() {
+		stackDeferSink = make([]byte, 1024)
+		r += i + 1
+	}()
+	stackDeferSink = make([]byte, 1024)
+	runtime.Gosched()
+	return i + 1
+}
@@ -5,6 +5,8 @@
 package runtime
 
 import (
+	"runtime/internal/atomic"
+	"runtime/internal/sys"
 	"unsafe"
 )
 
@@ -13,6 +15,7 @@ import (
 //
 //go:linkname requireitab runtime.requireitab
 //go:linkname assertitab runtime.assertitab
+//go:linkname assertitabCache runtime.assertitabCache
 //go:linkname assertI2T runtime.assertI2T
 //go:linkname ifacetypeeq runtime.ifacetypeeq
 //go:linkname efacetype runtime.efacetype
@@ -26,6 +29,11 @@ import (
 //go:linkname ifaceE2T2 runtime.ifaceE2T2
 //go:linkname ifaceI2T2 runtime.ifaceI2T2
 //go:linkname ifaceT2Ip runtime.ifaceT2Ip
+//go:linkname ifaceT2IpCache runtime.ifaceT2IpCache
+//go:linkname ifaceT2ItabCache runtime.ifaceT2ItabCache
+//go:linkname convT8 runtime.convT8
+//go:linkname convT64 runtime.convT64
+//go:linkname registerITabs runtime.registerITabs
 // Temporary for C code to call:
 //go:linkname getitab runtime.getitab
 
@@ -73,6 +81,125 @@ import (
 
 // For a nil interface value both fields in the interface struct are nil.
 
+// itabEntry is an entry in the itab cache. The compiler builds an
+// array of these for the interface method tables that it creates
+// statically, and passes it to registerITabs; keep in sync with
+// Gogo::register_itabs.
+type itabEntry struct {
+	inter *_type         // interface type
+	itab  unsafe.Pointer // method table; the first word is the dynamic type
+}
+
+const itabInitSize = 512
+
+// itabTableType is an open addressed hash table of interface method
+// tables, keyed by interface type and dynamic type. Lookups do not
+// lock; additions are made while holding itabLock. The table and
+// everything it refers to is allocated with persistentalloc, so the
+// garbage collector does not need to know about any of it.
+type itabTableType struct {
+	size    uintptr                  // length of entries array; always a power of 2
+	count   uintptr                  // current number of filled entries
+	entries [itabInitSize]*itabEntry // really [size] large
+}
+
+var (
+	itabLock      mutex                               // lock for adding to itabTable
+	itabTableInit = itabTableType{size: itabInitSize} // starter table
+	itabTable     = &itabTableInit                    // pointer to current table
+)
+
+func itabHashFunc(inter, typ *_type) uintptr {
+	return uintptr(inter.hash ^ typ.hash)
+}
+
+// itabType returns the dynamic type of an interface method table.
+func itabType(itab unsafe.Pointer) *_type {
+	return *(**_type)(itab)
+}
+
+// find returns the method table for inter and typ, or nil if there
+// is none in the table.
+func (t *itabTableType) find(inter, typ *_type) unsafe.Pointer {
+	// Use quadratic probing; the probe sequence visits every
+	// entry because the size is a power of 2.
+	mask := t.size - 1
+	h := itabHashFunc(inter, typ) & mask
+	for i := uintptr(1); ; i++ {
+		p := (**itabEntry)(add(unsafe.Pointer(&t.entries), h*sys.PtrSize))
+		// Use atomic read here so if we see m != nil, we also
+		// see the initializations of the fields of m.
+		m := (*itabEntry)(atomic.Loadp(unsafe.Pointer(p)))
+		if m == nil {
+			return nil
+		}
+		if eqtype(m.inter, inter) && eqtype(itabType(m.itab), typ) {
+			return m.itab
+		}
+		h += i
+		h &= mask
+	}
+}
+
+// add adds m to the table, unless there is already an entry for the
+// same types. The caller must hold itabLock and must have made room.
+func (t *itabTableType) add(m *itabEntry) {
+	typ := itabType(m.itab)
+	mask := t.size - 1
+	h := itabHashFunc(m.inter, typ) & mask
+	for i := uintptr(1); ; i++ {
+		p := (**itabEntry)(add(unsafe.Pointer(&t.entries), h*sys.PtrSize))
+		m2 := *p
+		if m2 == nil {
+			// Use atomic write here so if a reader sees m,
+			// it also sees the initialized fields of m.
+			atomic.StorepNoWB(unsafe.Pointer(p), unsafe.Pointer(m))
+			t.count++
+			return
+		}
+		if eqtype(m2.inter, m.inter) && eqtype(itabType(m2.itab), typ) {
+			return
+		}
+		h += i
+		h &= mask
+	}
+}
+
+// itabAdd adds m to the current table, growing the table if
+// necessary. The caller must hold itabLock.
+func itabAdd(m *itabEntry) {
+	t := itabTable
+	if t.count >= 3*(t.size/4) { // 75% load factor
+		// Grow hash table. t2 = new(itabTableType) with a
+		// larger entries array; allocate by hand since the
+		// array is really larger than it says.
+		t2 := (*itabTableType)(persistentalloc((2+2*t.size)*sys.PtrSize, sys.PtrSize, &memstats.other_sys))
+		t2.size = t.size * 2
+		for i := uintptr(0); i < t.size; i++ {
+			if m2 := *(**itabEntry)(add(unsafe.Pointer(&t.entries), i*sys.PtrSize)); m2 != nil {
+				t2.add(m2)
+			}
+		}
+		// Publish the new table. Readers still using the old
+		// table see a consistent, if incomplete, set of
+		// entries.
+		atomic.StorepNoWB(unsafe.Pointer(&itabTable), unsafe.Pointer(t2))
+		t = t2
+	}
+	t.add(m)
+}
+
+// registerITabs is called by init functions to add the interface
+// method tables built by the compiler to the cache. Init functions
+// may start goroutines that convert interfaces, so this locks.
+func registerITabs(tabs *itabEntry, n int) {
+	lock(&itabLock)
+	for i := 0; i < n; i++ {
+		itabAdd((*itabEntry)(add(unsafe.Pointer(tabs), uintptr(i)*unsafe.Sizeof(*tabs))))
+	}
+	unlock(&itabLock)
+}
+
 // Return the interface method table for a value of type rhs converted
 // to an interface of type lhs.
 func getitab(lhs, rhs *_type, canfail bool) unsafe.Pointer {
@@ -80,6 +207,14 @@ func getitab(lhs, rhs *_type, canfail bool) unsafe.Pointer {
 		return nil
 	}
 
+	// Look in the cache first; this is the common case. Failed
+	// conversions are not cached, so they fall through to report
+	// the missing method.
+	t := (*itabTableType)(atomic.Loadp(unsafe.Pointer(&itabTable)))
+	if itab := t.find(lhs, rhs); itab != nil {
+		return itab
+	}
+
 	if lhs.kind&kindMask != kindInterface {
 		throw("getitab called for non-interface type")
 	}
@@ -133,7 +268,27 @@ func getitab(lhs, rhs *_type, canfail bool) unsafe.Pointer {
 		ri++
 	}
 
-	return unsafe.Pointer(&methods[0])
+	return itabInsert(lhs, rhs, methods)
+}
+
+// itabInsert adds the method table in methods to the cache, and
+// returns the cached copy. Another goroutine may have added the same
+// table since we looked, in which case we use that one.
+func itabInsert(lhs, rhs *_type, methods []unsafe.Pointer) unsafe.Pointer {
+	lock(&itabLock)
+	if itab := itabTable.find(lhs, rhs); itab != nil {
+		unlock(&itabLock)
+		return itab
+	}
+	size := uintptr(len(methods)) * sys.PtrSize
+	itab := persistentalloc(size, sys.PtrSize, &memstats.other_sys)
+	memmove(itab, unsafe.Pointer(&methods[0]), size)
+	m := (*itabEntry)(persistentalloc(unsafe.Sizeof(itabEntry{}), sys.PtrSize, &memstats.other_sys))
+	m.inter = lhs
+	m.itab = itab
+	itabAdd(m)
+	unlock(&itabLock)
+	return itab
 }
 
 // Return the interface method table for a value of type rhs converted
@@ -163,6 +318,16 @@ func assertitab(lhs, rhs *_type) unsafe.Pointer {
 	return getitab(lhs, rhs, false)
 }
 
+// Like assertitab, but also store the method table in *cache. The
+// compiler gives each type assertion site its own cache, and only
+// calls this when the cached table is not for the dynamic type rhs.
+// The first word of a method table is its dynamic type.
+func assertitabCache(lhs, rhs *_type, cache *uintptr) unsafe.Pointer {
+	itab := assertitab(lhs, rhs)
+	atomic.Storeuintptr(cache, uintptr(itab))
+	return itab
+}
+
 // Check whether an interface type may be converted to a non-interface
 // type, panicing if not.
 func assertI2T(lhs, rhs, inter *_type) {
@@ -280,6 +445,97 @@ func ifaceI2T2(t *_type, i iface, ret unsafe.Pointer) bool {
 	}
 }
 
+// staticbytes is used by convT8 to avoid allocating when converting
+// a byte sized value to an interface.
+var staticbytes = [...]byte{
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+	0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+	0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+	0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57,
+	0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+	0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+	0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+	0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+	0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+	0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7,
+	0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7,
+	0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+	0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+}
+
+// staticuint64s is used by convT64 to avoid allocating when
+// converting a small integer value to an interface.
+var staticuint64s = [...]uint64{
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+	0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+	0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+	0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+	0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57,
+	0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+	0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77,
+	0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+	0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7,
+	0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+	0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7,
+	0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7,
+	0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+	0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+}
+
+// convT8 returns a pointer to a copy of val, for use as the data
+// word of an interface holding a byte sized value.
+func convT8(val uint8) unsafe.Pointer {
+	return unsafe.Pointer(&staticbytes[val])
+}
+
+// convT64 returns a pointer to a copy of val, for use as the data
+// word of an interface holding an 8 byte integer.
+func convT64(val uint64) unsafe.Pointer {
+	if val < uint64(len(staticuint64s)) {
+		return unsafe.Pointer(&staticuint64s[val])
+	}
+	x := mallocgc(8, nil, false)
+	*(*uint64)(x) = val
+	return x
+}
+
 // Return whether we can convert a type to an interface type.
 func ifaceT2Ip(to, from *_type) bool {
 	if from == nil {
@@ -323,6 +579,30 @@ func ifaceT2Ip(to, from *_type) bool {
 	return true
 }
 
+// Return whether we can convert a type to a non-empty interface type,
+// storing the method table in *cache if so. The compiler only calls
+// this when the method table cached at the call site is not for the
+// type from.
+func ifaceT2IpCache(to, from *_type, cache *uintptr) bool {
+	return ifaceT2ItabCache(to, from, cache) != nil
+}
+
+// Return the method table for converting a type to a non-empty
+// interface type, or nil if the conversion is not possible, storing
+// the method table in *cache if there is one. The compiler calls this
+// for a comma-ok type assertion when the method table cached at the
+// call site is not for the type from.
+func ifaceT2ItabCache(to, from *_type, cache *uintptr) unsafe.Pointer {
+	if from == nil {
+		return nil
+	}
+	itab := getitab(to, from, true)
+	if itab != nil {
+		atomic.Storeuintptr(cache, uintptr(itab))
+	}
+	return itab
+}
+
 //go:linkname reflect_ifaceE2I reflect.ifaceE2I
 func reflect_ifaceE2I(inter *interfacetype, e eface, dst *iface) {
 	t := e._type
@@ -22,6 +22,7 @@ import (
 // themselves, so that the compiler will export them.
 //
 //go:linkname writebarrierptr runtime.writebarrierptr
+//go:linkname writebarrierptrs runtime.writebarrierptrs
 //go:linkname typedmemmove runtime.typedmemmove
 //go:linkname typedslicecopy runtime.typedslicecopy
 
@@ -226,6 +227,48 @@ func writebarrierptr(dst *uintptr, src uintptr) {
 	*dst = src
 }
 
+// writebarrierptrs performs n pointer stores with write barriers.
+// pairs points to n (dst, src) pairs: each dst is really a
+// *unsafe.Pointer and each src an unsafe.Pointer, as for
+// writebarrierptr. The compiler calls this for a run of consecutive
+// pointer stores when write barriers are enabled, so that the
+// barriers for stores into the heap are recorded in the per-P write
+// barrier buffer rather than shaded one at a time.
+//go:nosplit
+func writebarrierptrs(pairs *uintptr, n uintptr) {
+	p := (*[1 << 16][2]uintptr)(unsafe.Pointer(pairs))[:n:n]
+	if writeBarrier.cgo {
+		for i := range p {
+			cgoCheckWriteBarrier((*uintptr)(unsafe.Pointer(p[i][0])), p[i][1])
+		}
+	}
+	if writeBarrier.needed {
+		for i := range p {
+			dst := (*uintptr)(unsafe.Pointer(p[i][0]))
+			src := p[i][1]
+			if src != 0 && src < minPhysPageSize {
+				systemstack(func() {
+					print("runtime: writebarrierptrs *", dst, " = ", hex(src), "\n")
+					throw("bad pointer in write barrier")
+				})
+			}
+			if !inheap(uintptr(unsafe.Pointer(dst))) {
+				// Not a heap slot; let the single pointer
+				// barrier handle globals.
+				writebarrierptr_prewrite1(dst, src)
+				continue
+			}
+			buf := &getg().m.p.ptr().wbBuf
+			if !buf.putFast(*dst, src) {
+				wbBufFlush(nil, 0)
+			}
+		}
+	}
+	for i := range p {
+		*(*uintptr)(unsafe.Pointer(p[i][0])) = p[i][1]
+	}
+}
+
 // writebarrierptr_prewrite is like writebarrierptr, but the store
 // will be performed by the caller after this call. The caller must
 // not allow preemption between this call and the write.
@@ -103,6 +103,45 @@ func deferproc(frame *bool, pfn uintptr, arg unsafe.Pointer) {
 	d.makefunccanrecover = false
 }
 
+// deferprocStack queues a new deferred function with a defer record
+// in the caller's stack frame.  The compiler uses this for a defer
+// statement that is executed at most once each time the function is
+// called.  The record d need not be initialized.  The other arguments
+// are as for deferproc.
+//go:nosplit
+func deferprocStack(d *_defer, frame *bool, pfn uintptr, arg unsafe.Pointer) {
+	gp := getg()
+	if gp.m.curg != gp {
+		// Go code on the system stack can't defer.
+		throw("defer on system stack")
+	}
+	d.pfn = pfn
+	d.retaddr = 0
+	d.makefunccanrecover = false
+	d.heap = false
+	// The lines below implement:
+	//   d.frame = frame
+	//   d.panicStack = gp._panic
+	//   d._panic = nil
+	//   d.arg = arg
+	//   d.link = gp._defer
+	//   gp._defer = d
+	// The first five are writes to the stack, which don't need a
+	// write barrier, and they are to uninitialized memory, so they
+	// must not use one.  The last one does need the write barrier:
+	// the old gp._defer may be a heap record that is now only
+	// reachable through d.link, and scanstack does not walk the
+	// defer chain, so if this stack has already been scanned the
+	// deletion barrier must shade the old record.  The new value
+	// is a pointer to the stack, which the barrier ignores.
+	*(*uintptr)(unsafe.Pointer(&d.frame)) = uintptr(unsafe.Pointer(frame))
+	*(*uintptr)(unsafe.Pointer(&d.panicStack)) = uintptr(unsafe.Pointer(gp._panic))
+	*(*uintptr)(unsafe.Pointer(&d._panic)) = 0
+	*(*uintptr)(unsafe.Pointer(&d.arg)) = uintptr(arg)
+	*(*uintptr)(unsafe.Pointer(&d.link)) = uintptr(unsafe.Pointer(gp._defer))
+	writebarrierptr((*uintptr)(unsafe.Pointer(&gp._defer)), uintptr(unsafe.Pointer(d)))
+}
+
 // Allocate a Defer, usually using per-P pool.
 // Each defer must be released with freedefer.
 func newdefer() *_defer {
@@ -131,6 +170,7 @@ func newdefer() *_defer {
 			d = new(_defer)
 		})
 	}
+	d.heap = true
 	d.link = gp._defer
 	gp._defer = d
 	return d
@@ -144,6 +184,10 @@ func newdefer() *_defer {
 //
 //go:nosplit
 func freedefer(d *_defer) {
+	if !d.heap {
+		// A defer record in a stack frame goes away with the frame.
+		return
+	}
 	pp := getg().m.p.ptr()
 	if len(pp.deferpool) == cap(pp.deferpool) {
 		// Transfer half of local cache to the central cache.
@@ -181,6 +225,7 @@ func freedefer(d *_defer) {
 	d.arg = nil
 	d.retaddr = 0
 	d.makefunccanrecover = false
+	d.heap = false
 
 	pp.deferpool = append(pp.deferpool, d)
 }
@@ -2612,6 +2612,7 @@ func goexit0(gp *g) {
 	gp.writebuf = nil
 	gp.waitreason = ""
 	gp.param = nil
+	gp.goargs = [goArgWords]unsafe.Pointer{}
 	gp.labels = nil
 	gp.timer = nil
 
@@ -3075,6 +3076,26 @@ func syscall_runtime_AfterExec() {
 // The compiler turns a go statement into a call to this.
 //go:linkname newproc __go_go
 func newproc(fn uintptr, arg unsafe.Pointer) *g {
+	return newproc1(fn, arg, nil, 0, getcallerpc())
+}
+
+// newprocargs is like newproc, but rather than passing a pointer to
+// a heap allocated argument block it copies the size bytes at args
+// into the new g, and passes a pointer to that copy.  The compiler
+// uses this for go statements whose arguments are all pointers and
+// fit in goArgWords words, so that they need not be allocated.
+//go:linkname newprocargs runtime.newprocargs
+func newprocargs(fn uintptr, args unsafe.Pointer, size uintptr) {
+	if size > goArgWords*sys.PtrSize {
+		throw("newprocargs: arguments too large")
+	}
+	newproc1(fn, nil, args, size, getcallerpc())
+}
+
+// newproc1 creates a new g as described for newproc.  If size is not
+// zero, the new g is passed a copy of the size bytes at args, which
+// must all be pointers, instead of arg.
+func newproc1(fn uintptr, arg unsafe.Pointer, args unsafe.Pointer, size uintptr, callerpc uintptr) *g {
 	_g_ := getg()
 
 	if fn == 0 {
@@ -3110,8 +3131,15 @@ func newproc(fn uintptr, arg unsafe.Pointer) *g {
 	*(*unsafe.Pointer)(unsafe.Pointer(&entry)) = unsafe.Pointer(&newg.entryfn)
 	newg.entry = entry
 
+	if size > 0 {
+		src := (*[goArgWords]unsafe.Pointer)(args)
+		for i := uintptr(0); i < size/sys.PtrSize; i++ {
+			newg.goargs[i] = src[i]
+		}
+		arg = unsafe.Pointer(&newg.goargs)
+	}
 	newg.param = arg
-	newg.gopc = getcallerpc()
+	newg.gopc = callerpc
 	newg.startpc = fn
 	if _g_.m.curg != nil {
 		newg.labels = _g_.m.curg.labels
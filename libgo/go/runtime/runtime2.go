@@ -435,8 +435,18 @@ type g struct {
 
 	context      g_ucontext_t // saved context for setcontext
 	stackcontext [10]uintptr  // split-stack context
+
+	// goargs holds the arguments of a go statement copied by
+	// newprocargs; param points to it.  The compiler only uses
+	// newprocargs when every word of the arguments is a pointer.
+	goargs [goArgWords]unsafe.Pointer
 }
 
+// goArgWords is the number of words of goroutine arguments that
+// newprocargs can copy into the g.  This must match go_args_words in
+// the compiler's statements.cc.
+const goArgWords = 4
+
 type m struct {
 	g0 *g // goroutine with scheduling stack
 	// Not for gccgo: morebuf gobuf  // gobuf arg to morestack
@@ -750,6 +760,12 @@ type _defer struct {
 	// function function will be somewhere in libffi, so __retaddr
 	// is not useful.
 	makefunccanrecover bool
+
+	// Whether the _defer is heap allocated.  A defer statement
+	// that is not in a loop uses a record in the stack frame of
+	// the function; see deferprocStack.  The compiler lays out
+	// such records itself, so it must know this struct.
+	heap bool
 }
 
 // panics
@@ -106,6 +106,8 @@ func BenchmarkSliceByteToString(b *testing.B) {
 
 var stringdata = []struct{ name, data string }{
 	{"ASCII", "01234567890"},
+	{"ASCIILong", "The quick brown fox jumps over the lazy dog, 0123456789 times."},
+	{"MostlyASCII", "Größe: 42 cm, Preis: 9,99 €, naïve café, 日本 ok."},
 	{"Japanese", "日本語日本語日本語"},
 	{"MixedLength", "$Ѐࠀက퀀𐀀\U00040000\U0010FFFF"},
 }
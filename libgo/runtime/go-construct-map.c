@@ -28,14 +28,29 @@ __go_construct_map (const struct __go_map_type *type,
   const unsigned char *entries;
   uintptr_t i;
   void *p;
+  const struct __go_type_descriptor *val_type;
 
   ret = makemap(type, (intgo) count, NULL);
 
   entries = (const unsigned char *) ventries;
+  val_type = type->__val_type;
+  if ((val_type->__code & GO_NO_POINTERS) != 0)
+    {
+      /* The values contain no pointers, so there is no need for
+	 typedmemmove to check for write barriers on every entry.  */
+      for (i = 0; i < count; ++i)
+	{
+	  p = mapassign (type, ret, entries);
+	  __builtin_memcpy (p, entries + val_offset, val_type->__size);
+	  entries += entry_size;
+	}
+      return ret;
+    }
+
   for (i = 0; i < count; ++i)
     {
       p = mapassign (type, ret, entries);
-      typedmemmove (type->__val_type, p, entries + val_offset);
+      typedmemmove (val_type, p, entries + val_offset);
       entries += entry_size;
     }
 